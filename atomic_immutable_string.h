@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+#include "immutable_string.h"
+#include "epoch_reclamation.h"
+
+// A slot holding a weak_immutable_string that can be replaced while other
+// threads read it. The whole string (pointer and size) is one 8 byte word,
+// so publishing is a single atomic exchange and reading is a single load
+// under an epoch guard. Replaced buffers are freed through
+// epoch_reclamation.h once no reader can still see them.
+class atomic_immutable_string {
+
+public:
+
+    using string_type = weak_immutable_string;
+    using view_type = weak_immutable_string_impl;
+    using buffer_type = string_type::buffer_type;
+
+    // A consistent view of the value at the time of load(). The buffer
+    // stays alive for as long as the snapshot does, so keep it short.
+    class snapshot {
+
+        epoch::guard m_guard;
+        view_type m_view;
+
+        friend class atomic_immutable_string;
+
+        snapshot(epoch::guard &&guard, buffer_type buf)
+        :m_guard{ std::move(guard) }, m_view{ buf.pointer(), buf.integer() }
+        {}
+
+    public:
+
+        inline const view_type &get() const noexcept {
+            return m_view;
+        }
+
+        inline const view_type &operator*() const noexcept {
+            return m_view;
+        }
+
+        inline const view_type* operator->() const noexcept {
+            return &m_view;
+        }
+    };
+
+private:
+
+    std::atomic<std::uintptr_t> m_word;
+
+    static void free_buffer(void* word) {
+        string_type{ adopt_buffer, buffer_type::from_raw(reinterpret_cast<std::uintptr_t>(word)) };
+    }
+
+    static inline std::uintptr_t take(string_type &&str) noexcept {
+        return str.release_buffer().raw();
+    }
+
+public:
+
+    atomic_immutable_string()
+    :m_word{ take(string_type{}) }
+    {}
+
+    explicit atomic_immutable_string(string_type &&str)
+    :m_word{ take(std::move(str)) }
+    {}
+
+    atomic_immutable_string(const atomic_immutable_string&) = delete;
+    atomic_immutable_string &operator=(const atomic_immutable_string&) = delete;
+
+    // No reader may be using the slot any more, so the last value goes
+    // immediately.
+    ~atomic_immutable_string() {
+        string_type{ adopt_buffer, buffer_type::from_raw(m_word.load(std::memory_order_relaxed)) };
+    }
+
+    inline snapshot load() const {
+        epoch::guard guard;
+        return snapshot{ std::move(guard), buffer_type::from_raw(m_word.load(std::memory_order_acquire)) };
+    }
+
+    // An owning copy of the current value.
+    inline string_type load_copy() const {
+        auto s = load();
+        return string_type{ s->c_str(), s->size() };
+    }
+
+    inline void store(string_type &&str) {
+        auto old = buffer_type::from_raw(m_word.exchange(take(std::move(str)), std::memory_order_acq_rel));
+        if (old.integer() != 0) {
+            epoch::retire(reinterpret_cast<void*>(old.raw()), &free_buffer);
+        }
+    }
+
+    // Publishes desired only if the slot still holds the buffer expected
+    // points at; on failure expected is refreshed and desired is untouched.
+    inline bool compare_exchange(snapshot &expected, string_type &desired) {
+        auto word = buffer_type{ expected->c_str(), expected->size() }.raw();
+        auto replacement = desired.release_buffer();
+        if (m_word.compare_exchange_strong(word, replacement.raw(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+            auto old = buffer_type::from_raw(word);
+            if (old.integer() != 0) {
+                epoch::retire(reinterpret_cast<void*>(old.raw()), &free_buffer);
+            }
+            return true;
+        }
+
+        desired = string_type{ adopt_buffer, replacement };
+        expected.m_view = view_type{ buffer_type::from_raw(word).pointer(), buffer_type::from_raw(word).integer() };
+        return false;
+    }
+};
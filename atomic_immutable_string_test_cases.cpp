@@ -0,0 +1,77 @@
+#include "test.h"
+#include "atomic_immutable_string.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("atomic immutable string") {
+    GIVEN("a single thread") {
+        atomic_immutable_string slot;
+        CHECK(slot.load()->empty());
+
+        slot.store(weak_immutable_string{ "first" });
+        {
+            auto s = slot.load();
+            CHECK(s->size() == 5);
+            CHECK(std::strcmp(s->c_str(), "first") == 0);
+
+            // The snapshot keeps the old buffer readable.
+            slot.store(weak_immutable_string{ "second" });
+            CHECK(std::strcmp(s->c_str(), "first") == 0);
+        }
+
+        auto copy = slot.load_copy();
+        CHECK(std::strcmp(copy.c_str(), "second") == 0);
+
+        slot.store(weak_immutable_string{});
+        CHECK(slot.load()->empty());
+    }
+
+    GIVEN("compare exchange") {
+        atomic_immutable_string slot{ weak_immutable_string{ "a" } };
+
+        auto expected = slot.load();
+        slot.store(weak_immutable_string{ "b" });
+
+        weak_immutable_string desired{ "c" };
+        CHECK(!slot.compare_exchange(expected, desired));
+        CHECK(std::strcmp(expected->c_str(), "b") == 0);
+        CHECK(std::strcmp(desired.c_str(), "c") == 0);
+
+        CHECK(slot.compare_exchange(expected, desired));
+        CHECK(desired.empty());
+        CHECK(std::strcmp(slot.load()->c_str(), "c") == 0);
+    }
+
+    GIVEN("concurrent readers and writers") {
+        atomic_immutable_string slot{ weak_immutable_string{ "value 0" } };
+        std::atomic<bool> done{ false };
+        std::atomic<int> bad{ 0 };
+
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 3; ++r) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    auto s = slot.load();
+                    std::string value{ s->c_str(), s->size() };
+                    if (value.compare(0, 6, "value ") != 0 || value.size() != std::strlen(s->c_str())) ++bad;
+                }
+            });
+        }
+
+        std::thread writer{ [&] {
+            for (int i = 1; i <= 20000; ++i) {
+                slot.store(weak_immutable_string{ "value " + std::to_string(i) });
+            }
+        } };
+
+        writer.join();
+        done = true;
+        for (auto &t : readers) t.join();
+
+        CHECK(bad == 0);
+        CHECK(std::strcmp(slot.load()->c_str(), "value 20000") == 0);
+    }
+}
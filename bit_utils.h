@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace detail {
+
+    inline unsigned popcount32(std::uint32_t x) noexcept {
+        x = x - ((x >> 1) & 0x55555555);
+        x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+        return (((x + (x >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
+    }
+
+}
@@ -1,5 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "immutable_string.h"
 
 struct string_compare_loose {
@@ -8,28 +20,31 @@ struct string_compare_loose {
     lt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(loose, lt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
-        return lhs.size() < rhs.size() || 
-               (lhs.size() == rhs.size() && std::strcmp(lhs.c_str(), rhs.c_str()) < 0);
+        return lhs_len < rhs_len || 
+               (lhs_len == rhs_len && std::strcmp(lhs.c_str(), rhs.c_str()) < 0);
     }
     template <typename Lhs, typename Rhs>
     static inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, bool>
     gt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(loose, gt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
-        return lhs.size() > rhs.size() || 
-               (lhs.size() == rhs.size() && std::strcmp(lhs.c_str(), rhs.c_str()) > 0);
+        return lhs_len > rhs_len || 
+               (lhs_len == rhs_len && std::strcmp(lhs.c_str(), rhs.c_str()) > 0);
     }
     template <typename Lhs, typename Rhs>
     static inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, bool>
     eq(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(loose, eq, lhs, rhs);
         return lhs.c_str() == rhs.c_str() || (lhs.size() == rhs.size() && std::strcmp(lhs.c_str(), rhs.c_str()) == 0);
     }
 };
@@ -40,6 +55,7 @@ struct string_compare_weak {
     lt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(weak, lt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         return std::strcmp(lhs.c_str(), rhs.c_str()) < 0;
     }
@@ -48,6 +64,7 @@ struct string_compare_weak {
     gt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(weak, gt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         return std::strcmp(lhs.c_str(), rhs.c_str()) > 0;
     }
@@ -56,6 +73,7 @@ struct string_compare_weak {
     eq(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(weak, eq, lhs, rhs);
         return lhs.c_str() == rhs.c_str() || (lhs.size() == rhs.size() && std::strcmp(lhs.c_str(), rhs.c_str()) == 0);
     }
 };
@@ -66,6 +84,7 @@ struct string_compare_safe {
     lt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(safe, lt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
@@ -77,6 +96,7 @@ struct string_compare_safe {
     gt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(safe, gt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
@@ -88,9 +108,10 @@ struct string_compare_safe {
     eq(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(safe, eq, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return true;
         auto lhs_len = lhs.size();
-        return lhs_len == rhs.size() && std::strncmp(lhs.c_str(), rhs.c_str(), lhs_len);
+        return lhs_len == rhs.size() && std::strncmp(lhs.c_str(), rhs.c_str(), lhs_len) == 0;
     }
 };
 
@@ -100,6 +121,7 @@ struct string_compare_pendatic {
     lt(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(pendatic, lt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
@@ -111,6 +133,7 @@ struct string_compare_pendatic {
     gt(const Lhs &lhs,
         const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(pendatic, gt, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return false;
         auto lhs_len = lhs.size();
         auto rhs_len = rhs.size();
@@ -122,8 +145,153 @@ struct string_compare_pendatic {
     eq(const Lhs &lhs,
        const Rhs &rhs) noexcept
     {
+        IMMUTABLE_STRING_STATS_COMPARE(pendatic, eq, lhs, rhs);
+        if (lhs.c_str() == rhs.c_str()) return true;
+        auto lhs_len = lhs.size();
+        return lhs_len == rhs.size() && std::memcmp(lhs.c_str(), rhs.c_str(), lhs_len) == 0;
+    }
+};
+
+namespace detail {
+
+    inline unsigned char ascii_fold(unsigned char c) noexcept {
+        return static_cast<unsigned char>(c - 'A') < 26 ? static_cast<unsigned char>(c | 0x20) : c;
+    }
+
+    // Lower cases the ASCII letters of eight bytes at once. Bytes >= 0x80
+    // are left alone.
+    inline std::uint64_t ascii_fold8(std::uint64_t w) noexcept {
+        constexpr std::uint64_t ones = 0x0101010101010101ULL;
+        std::uint64_t low7 = w & (0x7f * ones);
+        std::uint64_t at_least_a = low7 + (0x80 - 'A') * ones;
+        std::uint64_t above_z = low7 + (0x7f - 'Z') * ones;
+        std::uint64_t upper = at_least_a & ~above_z & ~w & (0x80 * ones);
+        return w | (upper >> 2);
+    }
+
+    struct ascii_fold_load {
+        inline std::uint64_t operator()(const char* str, std::size_t len) const noexcept {
+            return ascii_fold8(word_load{}(str, len));
+        }
+    };
+
+    inline unsigned lowest_bit(unsigned m) noexcept {
+#if defined(_MSC_VER)
+        unsigned long i;
+        _BitScanForward(&i, m);
+        return static_cast<unsigned>(i);
+#else
+        return static_cast<unsigned>(__builtin_ctz(m));
+#endif
+    }
+
+    // memcmp of the first n bytes after ASCII case folding.
+    inline int ascii_icase_compare(const char* lhs, const char* rhs, std::size_t n) noexcept {
+        std::size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128i before_a = _mm_set1_epi8('A' - 1);
+        const __m128i after_z = _mm_set1_epi8('Z' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+
+        // Bytes >= 0x80 are negative as signed chars, so they never count as
+        // upper case letters.
+        auto fold = [&](__m128i v) {
+            __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a), _mm_cmplt_epi8(v, after_z));
+            return _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+        };
+
+        for (; i + 16 <= n; i += 16) {
+            __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + i));
+            __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(l, r)) == 0xffff) continue;
+
+            unsigned diff = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(fold(l), fold(r)))) ^ 0xffff;
+            if (diff) {
+                i += lowest_bit(diff);
+                auto lc = ascii_fold(static_cast<unsigned char>(lhs[i]));
+                auto rc = ascii_fold(static_cast<unsigned char>(rhs[i]));
+                return lc < rc ? -1 : 1;
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            auto l = ascii_fold(static_cast<unsigned char>(lhs[i]));
+            auto r = ascii_fold(static_cast<unsigned char>(rhs[i]));
+            if (l != r) return l < r ? -1 : 1;
+        }
+        return 0;
+    }
+
+}
+
+// Orders like string_compare_pendatic after mapping A-Z to a-z, using the
+// stored lengths. Only ASCII letters are folded.
+struct string_compare_ascii_icase {
+    template <typename Lhs, typename Rhs>
+    static inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, bool>
+    lt(const Lhs &lhs,
+       const Rhs &rhs) noexcept
+    {
+        IMMUTABLE_STRING_STATS_COMPARE(ascii_icase, lt, lhs, rhs);
+        if (lhs.c_str() == rhs.c_str()) return false;
+        auto lhs_len = lhs.size();
+        auto rhs_len = rhs.size();
+        auto cmp = detail::ascii_icase_compare(lhs.c_str(), rhs.c_str(), std::min(lhs_len, rhs_len));
+        return cmp < 0 || (cmp == 0 && lhs_len < rhs_len);
+    }
+    template <typename Lhs, typename Rhs>
+    static inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, bool>
+    gt(const Lhs &lhs,
+       const Rhs &rhs) noexcept
+    {
+        IMMUTABLE_STRING_STATS_COMPARE(ascii_icase, gt, lhs, rhs);
+        if (lhs.c_str() == rhs.c_str()) return false;
+        auto lhs_len = lhs.size();
+        auto rhs_len = rhs.size();
+        auto cmp = detail::ascii_icase_compare(lhs.c_str(), rhs.c_str(), std::min(lhs_len, rhs_len));
+        return cmp > 0 || (cmp == 0 && lhs_len > rhs_len);
+    }
+    template <typename Lhs, typename Rhs>
+    static inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, bool>
+    eq(const Lhs &lhs,
+       const Rhs &rhs) noexcept
+    {
+        IMMUTABLE_STRING_STATS_COMPARE(ascii_icase, eq, lhs, rhs);
         if (lhs.c_str() == rhs.c_str()) return true;
         auto lhs_len = lhs.size();
-        return lhs_len == rhs.size() && std::memcmp(lhs.c_str(), rhs.c_str(), lhs_len);
+        return lhs_len == rhs.size() && detail::ascii_icase_compare(lhs.c_str(), rhs.c_str(), lhs_len) == 0;
+    }
+};
+
+// Hash that agrees with string_compare_ascii_icase::eq, for unordered
+// containers of views using that policy.
+struct string_hash_ascii_icase {
+    static inline std::size_t hash(const char* str, std::size_t len) noexcept {
+        auto h = detail::word_hash(str, len, 0, detail::ascii_fold_load{});
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+    template <typename T>
+    inline std::size_t operator()(const T &str) const noexcept {
+        return hash(str.data(), str.size());
+    }
+};
+
+// Hashes the bytes as they are, agreeing with string_compare_pendatic.
+struct string_hash_pendatic {
+    template <typename T>
+    inline std::size_t operator()(const T &str) const noexcept {
+        return detail::immutable_string_hash(str.data(), str.size());
+    }
+};
+
+// Function object ordering by one of the policies above, for ordered
+// containers that take a less-than predicate, e.g.
+// std::map<weak_immutable_string, T, string_less<string_compare_pendatic>>.
+template <typename Policy>
+struct string_less {
+    template <typename Lhs, typename Rhs>
+    inline bool operator()(const Lhs &lhs, const Rhs &rhs) const noexcept {
+        return Policy::lt(lhs, rhs);
     }
 };
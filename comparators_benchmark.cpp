@@ -0,0 +1,190 @@
+// Benchmarks the comparator policies in comparators.h over a few corpus
+// shapes. Usage:
+//
+//     comparators_benchmark [short|urls|ids|all] [count] [seed]
+
+#include "immutable_string.h"
+#include "comparators.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+    using view_type = weak_immutable_string_impl;
+
+    //
+    // Corpora
+    //
+
+    std::string random_chars(std::mt19937_64 &rng, std::size_t len, const char* alphabet, std::size_t alphabet_size) {
+        std::uniform_int_distribution<std::size_t> pick{ 0, alphabet_size - 1 };
+        std::string str(len, ' ');
+        for (auto &c : str) {
+            c = alphabet[pick(rng)];
+        }
+        return str;
+    }
+
+    // Uniform keys of 4 to 16 lower case letters.
+    std::vector<std::string> short_keys(std::size_t count, std::mt19937_64 &rng) {
+        std::uniform_int_distribution<std::size_t> len{ 4, 16 };
+        std::vector<std::string> corpus;
+        for (std::size_t i = 0; i < count; ++i) {
+            corpus.push_back(random_chars(rng, len(rng), "abcdefghijklmnopqrstuvwxyz", 26));
+        }
+        return corpus;
+    }
+
+    // Long URLs that share most of their prefix.
+    std::vector<std::string> shared_prefix_urls(std::size_t count, std::mt19937_64 &rng) {
+        static const char* const sections[] = { "users", "orders", "products", "inventory" };
+        std::uniform_int_distribution<std::size_t> section{ 0, 3 };
+        std::uniform_int_distribution<std::uint32_t> id{ 0, 999999 };
+        std::vector<std::string> corpus;
+        for (std::size_t i = 0; i < count; ++i) {
+            corpus.push_back("https://api.example.com/service/v2/regions/eu-west-1/" +
+                             std::string{ sections[section(rng)] } + "/" + std::to_string(id(rng)) +
+                             "/details?expand=" + random_chars(rng, 6, "abcdefghijklmnopqrstuvwxyz", 26));
+        }
+        return corpus;
+    }
+
+    // Fixed length hexadecimal identifiers.
+    std::vector<std::string> equal_length_ids(std::size_t count, std::mt19937_64 &rng) {
+        std::vector<std::string> corpus;
+        for (std::size_t i = 0; i < count; ++i) {
+            corpus.push_back(random_chars(rng, 24, "0123456789abcdef", 16));
+        }
+        return corpus;
+    }
+
+    //
+    // Measurements
+    //
+
+    struct result {
+        double lt_ns;
+        double eq_ns;
+        double sort_ms;
+        double set_ms;
+    };
+
+    template <typename F>
+    double elapsed_ns(F &&f) {
+        auto start = clock_type::now();
+        f();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count());
+    }
+
+    volatile std::size_t sink = 0;
+
+    template <typename Policy>
+    result run(const std::vector<view_type> &views, const std::vector<std::pair<std::size_t, std::size_t>> &pairs) {
+        result r{};
+        std::size_t hits = 0;
+
+        r.lt_ns = elapsed_ns([&] {
+            for (const auto &p : pairs) {
+                hits += Policy::lt(views[p.first], views[p.second]);
+            }
+        }) / static_cast<double>(pairs.size());
+
+        r.eq_ns = elapsed_ns([&] {
+            for (const auto &p : pairs) {
+                hits += Policy::eq(views[p.first], views[p.second]);
+            }
+        }) / static_cast<double>(pairs.size());
+
+        auto less = [](const view_type &lhs, const view_type &rhs) { return Policy::lt(lhs, rhs); };
+
+        auto sorted = views;
+        r.sort_ms = elapsed_ns([&] {
+            std::sort(sorted.begin(), sorted.end(), less);
+        }) / 1e6;
+
+        std::set<view_type, decltype(less)> set{ less };
+        r.set_ms = elapsed_ns([&] {
+            for (const auto &v : views) {
+                set.insert(v);
+            }
+        }) / 1e6;
+
+        sink = sink + hits + set.size();
+        return r;
+    }
+
+    void report(const char* policy, const result &r) {
+        std::printf("  %-10s %10.2f %14.1f %10.2f %14.1f %10.2f %10.2f\n",
+                    policy,
+                    r.lt_ns, 1e3 / r.lt_ns,
+                    r.eq_ns, 1e3 / r.eq_ns,
+                    r.sort_ms, r.set_ms);
+    }
+
+    void bench(const char* name, const std::vector<std::string> &corpus, std::mt19937_64 &rng) {
+        std::vector<view_type> views;
+        views.reserve(corpus.size());
+        for (const auto &str : corpus) {
+            views.emplace_back(str);
+        }
+
+        // Mix in some identical pointers so the fast path is exercised.
+        std::uniform_int_distribution<std::size_t> pick{ 0, corpus.size() - 1 };
+        std::vector<std::pair<std::size_t, std::size_t>> pairs;
+        for (std::size_t i = 0; i < corpus.size() * 4; ++i) {
+            auto lhs = pick(rng);
+            pairs.emplace_back(lhs, i % 16 == 0 ? lhs : pick(rng));
+        }
+
+        std::printf("%s (%zu strings, %zu compares)\n", name, corpus.size(), pairs.size());
+        std::printf("  %-10s %10s %14s %10s %14s %10s %10s\n", "policy", "lt ns", "lt Mcmp/s", "eq ns", "eq Mcmp/s", "sort ms", "set ms");
+        report("loose", run<string_compare_loose>(views, pairs));
+        report("weak", run<string_compare_weak>(views, pairs));
+        report("safe", run<string_compare_safe>(views, pairs));
+        report("pendatic", run<string_compare_pendatic>(views, pairs));
+        report("icase", run<string_compare_ascii_icase>(views, pairs));
+        std::printf("\n");
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::string corpus = argc > 1 ? argv[1] : "all";
+    std::size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    std::uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 42;
+
+    if (count == 0) {
+        std::fprintf(stderr, "count must be positive\n");
+        return 1;
+    }
+
+    std::mt19937_64 rng{ seed };
+    bool ran = false;
+
+    if (corpus == "short" || corpus == "all") {
+        bench("uniform short keys", short_keys(count, rng), rng);
+        ran = true;
+    }
+    if (corpus == "urls" || corpus == "all") {
+        bench("shared prefix urls", shared_prefix_urls(count, rng), rng);
+        ran = true;
+    }
+    if (corpus == "ids" || corpus == "all") {
+        bench("equal length ids", equal_length_ids(count, rng), rng);
+        ran = true;
+    }
+
+    if (!ran) {
+        std::fprintf(stderr, "usage: %s [short|urls|ids|all] [count] [seed]\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "epoch_reclamation.h"
+#include "ptr_int_pair_48va.h"
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+// Lock-free ordered map and set (Fraser / Herlihy-Shavit skip list). Every
+// link is a single ptr_int_pair_48va word whose tag holds the height of the
+// node owning the link, shifted left by one, and the deletion mark in bit 0.
+// A node is removed by marking its links top down, which also stops any
+// further insertion after it; whoever walks past a marked link swings the
+// predecessor over it with a single CAS. Unlinked nodes are freed through
+// epoch_reclamation.h, so readers never block and never see freed memory.
+//
+// Compare is a less-than predicate: std::less, ptr_int_pair_48va's
+// logical_comparator or opaque_comparator, or string_less<Policy> from
+// comparators.h for string keys. Lookups take anything Compare accepts.
+//
+// Values are fixed when their key is inserted. size() is exact only while
+// no update is in flight.
+
+namespace detail {
+
+    static constexpr int skip_max_height = 32;
+    static constexpr std::uint16_t skip_mark = 1;
+
+    // Set once the inserting thread has stopped linking a node and once the
+    // node has been logically deleted; whichever comes second unlinks it
+    // everywhere and retires it.
+    enum skip_node_state : std::uint8_t { skip_linked = 1, skip_removed = 2 };
+
+    struct skip_no_value {};
+
+    // The links are allocated right after the node, height of them.
+    template <typename Key, typename Value>
+    struct alignas(alignof(std::atomic<std::uintptr_t>)) skip_node {
+        using link = ptr_int_pair_48va<skip_node, std::uint16_t>;
+
+        Key key;
+        Value value;
+        std::atomic<std::uint8_t> state{ 0 };
+
+        template <typename K, typename V>
+        skip_node(K &&k, V &&v)
+        :key(std::forward<K>(k)), value(std::forward<V>(v))
+        {}
+
+        inline std::atomic<std::uintptr_t>* links() noexcept {
+            return reinterpret_cast<std::atomic<std::uintptr_t>*>(this + 1);
+        }
+
+        inline int height() noexcept {
+            return link::from_raw(links()[0].load(std::memory_order_relaxed)).integer() >> 1;
+        }
+
+        static std::size_t bytes(int height) noexcept {
+            return sizeof(skip_node) + static_cast<std::size_t>(height) * sizeof(std::atomic<std::uintptr_t>);
+        }
+
+        template <typename K, typename V>
+        static skip_node* create(int height, K &&k, V &&v) {
+            void* mem = ::operator new(bytes(height));
+            skip_node* n;
+            try {
+                n = new (mem) skip_node(std::forward<K>(k), std::forward<V>(v));
+            }
+            catch (...) {
+                ::operator delete(mem);
+                throw;
+            }
+            auto tag = static_cast<std::uint16_t>(height << 1);
+            for (int i = 0; i < height; ++i) {
+                new (&n->links()[i]) std::atomic<std::uintptr_t>(link{ nullptr, tag }.raw());
+            }
+            return n;
+        }
+
+        static void destroy(void* p) noexcept {
+            auto n = static_cast<skip_node*>(p);
+            auto size = bytes(n->height());
+            n->~skip_node();
+            ::operator delete(p, size);
+        }
+    };
+
+    // Geometric with p = 1/2, from a per thread xorshift generator.
+    inline int skip_random_height() noexcept {
+        thread_local std::uint64_t state = (reinterpret_cast<std::uintptr_t>(&state) * 0x9e3779b97f4a7c15ULL) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        int height = 1;
+        for (auto bits = state; height < skip_max_height && (bits & 1); bits >>= 1) ++height;
+        return height;
+    }
+
+}
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class concurrent_skip_map {
+
+    using node = detail::skip_node<Key, Value>;
+    using link = typename node::link;
+    using word = std::atomic<std::uintptr_t>;
+
+    static constexpr int max_height = detail::skip_max_height;
+
+public:
+
+    using key_type = Key;
+    using mapped_type = Value;
+    using size_type = std::size_t;
+
+private:
+
+    // A null node stands for the head.
+    mutable word m_head[max_height];
+    std::atomic<size_type> m_size{ 0 };
+    Compare m_less;
+
+    inline word* links_of(node* n) const noexcept {
+        return n != nullptr ? n->links() : m_head;
+    }
+
+    static inline std::uint16_t tag_of(node* n) noexcept {
+        return n != nullptr ? static_cast<std::uint16_t>(n->height() << 1) : 0;
+    }
+
+    static inline bool is_marked(link l) noexcept {
+        return l.integer() & detail::skip_mark;
+    }
+
+    static inline link load(word &w) noexcept {
+        return link::from_raw(w.load(std::memory_order_acquire));
+    }
+
+    // Swings pred's link at level from curr to succ.
+    inline bool snip(node* pred, int level, node* curr, node* succ) noexcept {
+        auto tag = tag_of(pred);
+        auto expected = link{ curr, tag }.raw();
+        return links_of(pred)[level].compare_exchange_strong(expected, link{ succ, tag }.raw(), std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+
+    // Fills preds with the last node before key and succs with the first
+    // node not before it at every level, unlinking marked nodes on the way.
+    // With sweep, every node equal to key is also walked past, so that a
+    // deleted one is unlinked even when a live duplicate sits in front of
+    // it. Returns false if a CAS lost a race and the walk must restart.
+    template <typename K>
+    bool try_locate(const K &key, node** preds, node** succs, bool sweep) noexcept {
+        node* pred = nullptr;
+        for (int level = max_height - 1; level >= 0; --level) {
+            auto curr = load(links_of(pred)[level]).pointer();
+            while (curr != nullptr) {
+                auto next = load(curr->links()[level]);
+                if (is_marked(next)) {
+                    if (!snip(pred, level, curr, next.pointer())) return false;
+                    curr = next.pointer();
+                }
+                else if (m_less(curr->key, key)) {
+                    pred = curr;
+                    curr = next.pointer();
+                }
+                else {
+                    break;
+                }
+            }
+            preds[level] = pred;
+            succs[level] = curr;
+
+            if (sweep) {
+                auto p = pred;
+                while (curr != nullptr && !m_less(key, curr->key)) {
+                    auto next = load(curr->links()[level]);
+                    if (is_marked(next)) {
+                        if (!snip(p, level, curr, next.pointer())) return false;
+                    }
+                    else {
+                        p = curr;
+                    }
+                    curr = next.pointer();
+                }
+            }
+        }
+        return true;
+    }
+
+    // Returns true if succs[0] holds key.
+    template <typename K>
+    bool locate(const K &key, node** preds, node** succs, bool sweep = false) noexcept {
+        while (!try_locate(key, preds, succs, sweep)) {}
+        return succs[0] != nullptr && !m_less(key, succs[0]->key);
+    }
+
+    // Read only walk that steps over marked nodes instead of unlinking them.
+    // The caller holds an epoch guard.
+    template <typename K>
+    node* lower_bound_node(const K &key) const noexcept {
+        node* pred = nullptr;
+        node* curr = nullptr;
+        for (int level = max_height - 1; level >= 0; --level) {
+            curr = load(links_of(pred)[level]).pointer();
+            while (curr != nullptr) {
+                auto next = load(curr->links()[level]);
+                if (is_marked(next)) {
+                    curr = next.pointer();
+                }
+                else if (m_less(curr->key, key)) {
+                    pred = curr;
+                    curr = next.pointer();
+                }
+                else {
+                    break;
+                }
+            }
+        }
+        return curr;
+    }
+
+    template <typename K>
+    node* find_node(const K &key) const noexcept {
+        auto n = lower_bound_node(key);
+        return n != nullptr && !m_less(key, n->key) ? n : nullptr;
+    }
+
+    // n is marked at every level and no longer being linked.
+    void unlink_and_retire(node* n) {
+        node* preds[max_height];
+        node* succs[max_height];
+        locate(n->key, preds, succs, true);
+        epoch::retire(n, &node::destroy);
+    }
+
+    // Links n at levels 1 and up, starting from the neighbours found when
+    // it went in at level 0. Stops early if n gets deleted meanwhile.
+    void link_tower(node* n, node** preds, node** succs) {
+        auto height = n->height();
+        auto tag = static_cast<std::uint16_t>(height << 1);
+
+        for (int level = 1; level < height; ++level) {
+            for (;;) {
+                auto &own = n->links()[level];
+                auto current = own.load(std::memory_order_acquire);
+                if (is_marked(link::from_raw(current))) return;
+                if (link::from_raw(current).pointer() != succs[level] &&
+                    !own.compare_exchange_strong(current, link{ succs[level], tag }.raw(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    continue;
+                }
+
+                auto pred_tag = tag_of(preds[level]);
+                auto expected = link{ succs[level], pred_tag }.raw();
+                if (links_of(preds[level])[level].compare_exchange_strong(expected, link{ n, pred_tag }.raw(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    break;
+                }
+                locate(n->key, preds, succs);
+            }
+        }
+    }
+
+public:
+
+    concurrent_skip_map() noexcept(std::is_nothrow_default_constructible<Compare>::value)
+    :m_less{}
+    {
+        for (auto &w : m_head) w.store(link{}.raw(), std::memory_order_relaxed);
+    }
+
+    explicit concurrent_skip_map(Compare less)
+    :m_less(std::move(less))
+    {
+        for (auto &w : m_head) w.store(link{}.raw(), std::memory_order_relaxed);
+    }
+
+    concurrent_skip_map(const concurrent_skip_map&) = delete;
+    concurrent_skip_map &operator=(const concurrent_skip_map&) = delete;
+
+    // No other thread may be using the map. Nodes erased earlier are
+    // already unlinked and belong to the epoch domain.
+    ~concurrent_skip_map() {
+        auto n = load(m_head[0]).pointer();
+        while (n != nullptr) {
+            auto next = load(n->links()[0]).pointer();
+            node::destroy(n);
+            n = next;
+        }
+    }
+
+    inline size_type size() const noexcept {
+        return m_size.load(std::memory_order_relaxed);
+    }
+
+    inline bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Adds key with value unless key is already present. Returns true if
+    // it was added.
+    template <typename K, typename V>
+    bool insert(K &&key, V &&value) {
+        epoch::guard guard;
+        node* preds[max_height];
+        node* succs[max_height];
+        node* fresh = nullptr;
+
+        for (;;) {
+            if (fresh == nullptr) {
+                if (locate(key, preds, succs)) return false;
+                fresh = node::create(detail::skip_random_height(), std::forward<K>(key), std::forward<V>(value));
+            }
+            else if (locate(fresh->key, preds, succs)) {
+                node::destroy(fresh);
+                return false;
+            }
+
+            auto height = fresh->height();
+            auto tag = static_cast<std::uint16_t>(height << 1);
+            for (int level = 0; level < height; ++level) {
+                fresh->links()[level].store(link{ succs[level], tag }.raw(), std::memory_order_relaxed);
+            }
+
+            auto pred_tag = tag_of(preds[0]);
+            auto expected = link{ succs[0], pred_tag }.raw();
+            if (links_of(preds[0])[0].compare_exchange_strong(expected, link{ fresh, pred_tag }.raw(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        m_size.fetch_add(1, std::memory_order_relaxed);
+
+        link_tower(fresh, preds, succs);
+        if (fresh->state.fetch_or(detail::skip_linked, std::memory_order_acq_rel) & detail::skip_removed) {
+            unlink_and_retire(fresh);
+        }
+        return true;
+    }
+
+    // Returns true if this call removed key.
+    template <typename K>
+    bool erase(const K &key) {
+        epoch::guard guard;
+        node* preds[max_height];
+        node* succs[max_height];
+        if (!locate(key, preds, succs)) return false;
+
+        auto victim = succs[0];
+        for (int level = victim->height() - 1; level >= 1; --level) {
+            auto &w = victim->links()[level];
+            auto current = w.load(std::memory_order_acquire);
+            while (!is_marked(link::from_raw(current))) {
+                auto l = link::from_raw(current);
+                w.compare_exchange_weak(current, link{ l.pointer(), static_cast<std::uint16_t>(l.integer() | detail::skip_mark) }.raw(),
+                                        std::memory_order_acq_rel, std::memory_order_acquire);
+            }
+        }
+
+        // Marking level 0 is the linearization point; only one eraser wins.
+        auto &bottom = victim->links()[0];
+        auto current = bottom.load(std::memory_order_acquire);
+        for (;;) {
+            auto l = link::from_raw(current);
+            if (is_marked(l)) return false;
+            if (bottom.compare_exchange_weak(current, link{ l.pointer(), static_cast<std::uint16_t>(l.integer() | detail::skip_mark) }.raw(),
+                                             std::memory_order_acq_rel, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+
+        if (victim->state.fetch_or(detail::skip_removed, std::memory_order_acq_rel) & detail::skip_linked) {
+            unlink_and_retire(victim);
+        }
+        return true;
+    }
+
+    template <typename K>
+    bool contains(const K &key) const {
+        epoch::guard guard;
+        return find_node(key) != nullptr;
+    }
+
+    // Copies the value of key into out. Returns false if key is absent.
+    template <typename K>
+    bool find(const K &key, Value &out) const {
+        epoch::guard guard;
+        auto n = find_node(key);
+        if (n == nullptr) return false;
+        out = n->value;
+        return true;
+    }
+
+    // Calls fn(const Key&, const Value&) for the entries not before from,
+    // in order, until fn returns false. Entries inserted or erased during
+    // the scan may or may not be seen.
+    template <typename K, typename Fn>
+    void scan(const K &from, Fn fn) const {
+        epoch::guard guard;
+        for (auto n = lower_bound_node(from); n != nullptr;) {
+            auto next = load(n->links()[0]);
+            if (!is_marked(next) && !fn(static_cast<const Key&>(n->key), static_cast<const Value&>(n->value))) return;
+            n = next.pointer();
+        }
+    }
+
+    // Calls fn(const Key&, const Value&) for every entry, in order.
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        epoch::guard guard;
+        for (auto n = load(m_head[0]).pointer(); n != nullptr;) {
+            auto next = load(n->links()[0]);
+            if (!is_marked(next)) fn(static_cast<const Key&>(n->key), static_cast<const Value&>(n->value));
+            n = next.pointer();
+        }
+    }
+};
+
+template <typename Key, typename Compare = std::less<Key>>
+class concurrent_skip_set {
+
+    concurrent_skip_map<Key, detail::skip_no_value, Compare> m_map;
+
+public:
+
+    using key_type = Key;
+    using size_type = std::size_t;
+
+    concurrent_skip_set() = default;
+
+    explicit concurrent_skip_set(Compare less)
+    :m_map(std::move(less))
+    {}
+
+    inline size_type size() const noexcept {
+        return m_map.size();
+    }
+
+    inline bool empty() const noexcept {
+        return m_map.empty();
+    }
+
+    template <typename K>
+    inline bool insert(K &&key) {
+        return m_map.insert(std::forward<K>(key), detail::skip_no_value{});
+    }
+
+    template <typename K>
+    inline bool erase(const K &key) {
+        return m_map.erase(key);
+    }
+
+    template <typename K>
+    inline bool contains(const K &key) const {
+        return m_map.contains(key);
+    }
+
+    // Calls fn(const Key&) for the keys not before from, in order, until fn
+    // returns false.
+    template <typename K, typename Fn>
+    void scan(const K &from, Fn fn) const {
+        m_map.scan(from, [&](const Key &key, const detail::skip_no_value&) { return fn(key); });
+    }
+
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        m_map.for_each([&](const Key &key, const detail::skip_no_value&) { fn(key); });
+    }
+};
@@ -0,0 +1,255 @@
+#include "test.h"
+#include "concurrent_skip_list.h"
+#include "comparators.h"
+#include "immutable_string.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    void drain() {
+        for (int i = 0; i < 4 && epoch::pending() > 0; ++i) {
+            epoch::collect();
+        }
+    }
+
+    struct object {
+        int id;
+    };
+
+}
+
+TEST_CASE("concurrent skip map") {
+    GIVEN("integer keys") {
+        concurrent_skip_map<int, std::string> map;
+        CHECK(map.empty());
+
+        for (int i : { 5, 1, 9, 3, 7 }) CHECK(map.insert(i, std::to_string(i * 10)));
+        CHECK(!map.insert(3, std::string{ "dup" }));
+        CHECK(map.size() == 5);
+
+        std::string value;
+        CHECK(map.find(3, value));
+        CHECK(value == "30");
+        CHECK(!map.find(4, value));
+        CHECK(map.contains(9));
+        CHECK(!map.contains(10));
+
+        std::vector<int> keys;
+        map.for_each([&](int key, const std::string&) { keys.push_back(key); });
+        CHECK(keys == (std::vector<int>{ 1, 3, 5, 7, 9 }));
+
+        CHECK(map.erase(5));
+        CHECK(!map.erase(5));
+        CHECK(!map.contains(5));
+        CHECK(map.size() == 4);
+
+        keys.clear();
+        map.scan(4, [&](int key, const std::string&) {
+            keys.push_back(key);
+            return key < 7;
+        });
+        CHECK(keys == (std::vector<int>{ 7 }));
+
+        keys.clear();
+        map.scan(0, [&](int key, const std::string&) {
+            keys.push_back(key);
+            return true;
+        });
+        CHECK(keys == (std::vector<int>{ 1, 3, 7, 9 }));
+
+        CHECK(map.insert(5, std::string{ "again" }));
+        CHECK(map.find(5, value));
+        CHECK(value == "again");
+        drain();
+    }
+
+    GIVEN("a reversed order") {
+        concurrent_skip_map<int, int, std::greater<int>> map;
+        for (int i = 0; i < 100; ++i) map.insert(i, i);
+
+        int previous = 100;
+        bool descending = true;
+        map.for_each([&](int key, int) {
+            descending = descending && key < previous;
+            previous = key;
+        });
+        CHECK(descending);
+    }
+
+    GIVEN("many keys") {
+        concurrent_skip_map<int, int> map;
+        for (int i = 0; i < 5000; ++i) CHECK(map.insert((i * 7919) % 5000, i));
+        CHECK(map.size() == 5000);
+        for (int i = 0; i < 5000; i += 2) CHECK(map.erase(i));
+        CHECK(map.size() == 2500);
+
+        bool ok = true;
+        int expected = 1;
+        map.for_each([&](int key, int) {
+            ok = ok && key == expected;
+            expected += 2;
+        });
+        CHECK(ok);
+        CHECK(expected == 5001);
+        drain();
+    }
+}
+
+TEST_CASE("concurrent skip map with string keys") {
+    using key = weak_immutable_string;
+
+    GIVEN("the pendatic order") {
+        concurrent_skip_map<key, int, string_less<string_compare_pendatic>> map;
+        map.insert(key{ "pear" }, 1);
+        map.insert(key{ "apple" }, 2);
+        map.insert(key{ "Zebra" }, 3);
+        map.insert(key{ "app" }, 4);
+
+        std::vector<std::string> keys;
+        map.for_each([&](const key &k, int) { keys.emplace_back(k.data(), k.size()); });
+        CHECK(keys == (std::vector<std::string>{ "Zebra", "app", "apple", "pear" }));
+
+        int value = 0;
+        CHECK(map.find(strong_immutable_string_impl{ "apple", 5 }, value));
+        CHECK(value == 2);
+        CHECK(map.erase(key{ "app" }));
+        CHECK(!map.contains(key{ "app" }));
+        drain();
+    }
+
+    GIVEN("the ASCII case insensitive order") {
+        concurrent_skip_set<key, string_less<string_compare_ascii_icase>> set;
+        CHECK(set.insert(key{ "pear" }));
+        CHECK(set.insert(key{ "Zebra" }));
+        CHECK(set.insert(key{ "apple" }));
+        CHECK(!set.insert(key{ "APPLE" }));
+        CHECK(set.contains(key{ "PEAR" }));
+
+        std::vector<std::string> keys;
+        set.for_each([&](const key &k) { keys.emplace_back(k.data(), k.size()); });
+        CHECK(keys == (std::vector<std::string>{ "apple", "pear", "Zebra" }));
+    }
+}
+
+TEST_CASE("concurrent skip set with pair keys") {
+    using pair_type = ptr_int_pair_48va<object, std::int16_t>;
+    std::vector<object> objects(4);
+
+    GIVEN("the logical order") {
+        concurrent_skip_set<pair_type, pair_type::logical_comparator> set;
+        set.insert(pair_type{ &objects[1], -1 });
+        set.insert(pair_type{ &objects[0], 5 });
+        set.insert(pair_type{ &objects[1], 2 });
+        set.insert(pair_type{ &objects[0], -3 });
+
+        std::vector<pair_type> keys;
+        set.for_each([&](const pair_type &p) { keys.push_back(p); });
+        REQUIRE(keys.size() == 4);
+        CHECK(keys[0] == (pair_type{ &objects[0], -3 }));
+        CHECK(keys[1] == (pair_type{ &objects[0], 5 }));
+        CHECK(keys[2] == (pair_type{ &objects[1], -1 }));
+        CHECK(keys[3] == (pair_type{ &objects[1], 2 }));
+    }
+
+    GIVEN("the opaque order") {
+        concurrent_skip_set<pair_type, pair_type::opaque_comparator> set;
+        for (auto &o : objects) {
+            for (std::int16_t i = -2; i <= 2; ++i) set.insert(pair_type{ &o, i });
+        }
+        CHECK(set.size() == 20);
+        CHECK(set.contains(pair_type{ &objects[2], -2 }));
+        CHECK(!set.insert(pair_type{ &objects[2], -2 }));
+
+        bool ordered = true;
+        bool first = true;
+        pair_type previous;
+        set.for_each([&](const pair_type &p) {
+            ordered = ordered && (first || previous.opaque_lt(p));
+            previous = p;
+            first = false;
+        });
+        CHECK(ordered);
+    }
+}
+
+TEST_CASE("concurrent skip map under contention") {
+    static constexpr int threads = 4;
+    static constexpr int per_thread = 2000;
+
+    GIVEN("threads inserting and erasing disjoint keys") {
+        concurrent_skip_map<int, int> map;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) map.insert(i * threads + t, t);
+                for (int i = 0; i < per_thread; i += 2) map.erase(i * threads + t);
+                drain();
+            });
+        }
+        for (auto &w : workers) w.join();
+
+        CHECK(map.size() == threads * per_thread / 2);
+        bool ok = true;
+        int previous = -1;
+        std::size_t count = 0;
+        map.for_each([&](int key, int value) {
+            ok = ok && key > previous && (key / threads) % 2 == 1 && key % threads == value;
+            previous = key;
+            ++count;
+        });
+        CHECK(ok);
+        CHECK(count == map.size());
+    }
+
+    GIVEN("threads racing on the same keys") {
+        static constexpr int keys = 64;
+        concurrent_skip_map<int, int> map;
+        std::atomic<int> inserted{ 0 };
+        std::atomic<int> erased{ 0 };
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < per_thread; ++i) {
+                    int k = (i * 31 + t * 17) % keys;
+                    if ((i + t) % 2 == 0) {
+                        inserted += map.insert(k, k);
+                    }
+                    else {
+                        erased += map.erase(k);
+                    }
+                    if (i % 64 == 0) std::this_thread::yield();
+                }
+                drain();
+            });
+        }
+
+        std::atomic<bool> done{ false };
+        bool reader_ok = true;
+        std::thread reader{ [&] {
+            while (!done.load()) {
+                int previous = -1;
+                map.for_each([&](int key, int value) {
+                    reader_ok = reader_ok && key > previous && key == value;
+                    previous = key;
+                });
+                std::this_thread::yield();
+            }
+        } };
+
+        for (auto &w : workers) w.join();
+        done = true;
+        reader.join();
+
+        CHECK(reader_ok);
+        std::size_t count = 0;
+        map.for_each([&](int, int) { ++count; });
+        CHECK(count == map.size());
+        CHECK(static_cast<std::size_t>(inserted - erased) == map.size());
+        drain();
+    }
+}
@@ -0,0 +1,318 @@
+// Measures packed pointer+tag words under concurrency: plain atomic loads,
+// CAS publishing a new pointer, CAS bumping the version tag, and a Treiber
+// stack whose head carries an ABA counter. Each word based workload runs on
+// one word shared by every thread, on per thread words packed next to each
+// other (false sharing only) and on per thread words padded to their own
+// cache line. Usage:
+//
+//     contention_benchmark [load|publish|version|treiber|all] [max_threads] [millis]
+
+#include "ptr_int_pair_48va.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using clock_type = std::chrono::steady_clock;
+
+    // next is atomic because a popper may read it while the node is being
+    // popped and pushed back elsewhere; the head's tag rejects that read.
+    struct node {
+        std::atomic<node*> next{ nullptr };
+    };
+
+    using pair_type = ptr_int_pair_48va<node, std::uint16_t>;
+
+    static constexpr std::size_t cache_line = 64;
+
+    struct alignas(cache_line) padded_word {
+        std::atomic<std::uintptr_t> word{ 0 };
+    };
+
+    enum class layout { shared, packed, padded };
+
+    const char* layout_name(layout l) {
+        switch (l) {
+        case layout::shared: return "shared";
+        case layout::packed: return "packed";
+        case layout::padded: return "padded";
+        }
+        return "";
+    }
+
+    // Words for up to max_threads threads in the chosen layout. word(t) is
+    // the one thread t works on.
+    class word_set {
+
+        layout m_layout;
+        std::unique_ptr<std::atomic<std::uintptr_t>[]> m_packed;
+        std::unique_ptr<padded_word[]> m_padded;
+
+    public:
+
+        word_set(layout l, std::size_t max_threads, std::uintptr_t initial)
+        :m_layout{ l }, m_packed{ new std::atomic<std::uintptr_t>[max_threads] }, m_padded{ new padded_word[max_threads] }
+        {
+            for (std::size_t t = 0; t < max_threads; ++t) {
+                m_packed[t].store(initial);
+                m_padded[t].word.store(initial);
+            }
+        }
+
+        std::atomic<std::uintptr_t> &word(std::size_t t) {
+            switch (m_layout) {
+            case layout::shared: return m_packed[0];
+            case layout::packed: return m_packed[t];
+            case layout::padded: return m_padded[t].word;
+            }
+            return m_packed[0];
+        }
+    };
+
+    //
+    // Measurements
+    //
+
+    struct counts {
+        std::uint64_t ops = 0;
+        std::uint64_t failures = 0;
+    };
+
+    struct alignas(cache_line) thread_counts {
+        counts c;
+    };
+
+    volatile std::uintptr_t sink = 0;
+
+    // Runs body(t, stop, counts&) on threads threads for millis and returns
+    // the summed counts and the measured seconds.
+    template <typename Body>
+    counts run_threads(std::size_t threads, unsigned millis, Body body, double &seconds) {
+        std::atomic<bool> stop{ false };
+        std::atomic<std::size_t> ready{ 0 };
+        std::atomic<bool> go{ false };
+        std::vector<thread_counts> results(threads);
+        std::vector<std::thread> workers;
+
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                body(t, stop, results[t].c);
+            });
+        }
+        while (ready.load() != threads) std::this_thread::yield();
+
+        auto start = clock_type::now();
+        go.store(true, std::memory_order_release);
+        std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+        stop.store(true, std::memory_order_relaxed);
+        for (auto &w : workers) w.join();
+        seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        counts total;
+        for (auto &r : results) {
+            total.ops += r.c.ops;
+            total.failures += r.c.failures;
+        }
+        return total;
+    }
+
+    // Stop is only checked every batch operations so it stays off the
+    // measured path.
+    static constexpr int batch = 256;
+
+    counts load_words(word_set &words, std::size_t threads, unsigned millis, double &seconds) {
+        return run_threads(threads, millis, [&](std::size_t t, std::atomic<bool> &stop, counts &c) {
+            auto &w = words.word(t);
+            std::uintptr_t acc = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < batch; ++i) {
+                    acc += pair_type::from_raw(w.load(std::memory_order_acquire)).integer();
+                }
+                c.ops += batch;
+            }
+            sink = sink + acc;
+        }, seconds);
+    }
+
+    // Swings the pointer to the thread's own node, keeping the tag.
+    counts publish_words(word_set &words, std::vector<node> &nodes, std::size_t threads, unsigned millis, double &seconds) {
+        return run_threads(threads, millis, [&](std::size_t t, std::atomic<bool> &stop, counts &c) {
+            auto &w = words.word(t);
+            auto mine = &nodes[t];
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < batch; ++i) {
+                    auto expected = w.load(std::memory_order_relaxed);
+                    auto desired = pair_type{ mine, pair_type::from_raw(expected).integer() }.raw();
+                    if (w.compare_exchange_strong(expected, desired, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        ++c.ops;
+                    }
+                    else {
+                        ++c.failures;
+                    }
+                }
+            }
+        }, seconds);
+    }
+
+    // Increments the 16 bit tag, keeping the pointer.
+    counts bump_versions(word_set &words, std::size_t threads, unsigned millis, double &seconds) {
+        return run_threads(threads, millis, [&](std::size_t t, std::atomic<bool> &stop, counts &c) {
+            auto &w = words.word(t);
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < batch; ++i) {
+                    auto expected = w.load(std::memory_order_relaxed);
+                    auto p = pair_type::from_raw(expected);
+                    auto desired = pair_type{ p.pointer(), static_cast<std::uint16_t>(p.integer() + 1) }.raw();
+                    if (w.compare_exchange_strong(expected, desired, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                        ++c.ops;
+                    }
+                    else {
+                        ++c.failures;
+                    }
+                }
+            }
+        }, seconds);
+    }
+
+    // Each operation pops a node and pushes it back. The head's tag counts
+    // successful pops so a stale head never passes the CAS (ABA).
+    counts treiber(std::size_t threads, unsigned millis, double &seconds) {
+        std::vector<node> nodes(threads * 4);
+        std::atomic<std::uintptr_t> head{ pair_type{}.raw() };
+        for (auto &n : nodes) {
+            auto h = pair_type::from_raw(head.load());
+            n.next.store(h.pointer());
+            head.store(pair_type{ &n, h.integer() }.raw());
+        }
+
+        return run_threads(threads, millis, [&](std::size_t, std::atomic<bool> &stop, counts &c) {
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < batch; ++i) {
+                    node* taken;
+                    auto expected = head.load(std::memory_order_acquire);
+                    for (;;) {
+                        auto h = pair_type::from_raw(expected);
+                        taken = h.pointer();
+                        if (taken == nullptr) {
+                            expected = head.load(std::memory_order_acquire);
+                            continue;
+                        }
+                        auto desired = pair_type{ taken->next.load(std::memory_order_relaxed), static_cast<std::uint16_t>(h.integer() + 1) }.raw();
+                        if (head.compare_exchange_weak(expected, desired, std::memory_order_acq_rel, std::memory_order_acquire)) break;
+                        ++c.failures;
+                    }
+
+                    expected = head.load(std::memory_order_relaxed);
+                    for (;;) {
+                        auto h = pair_type::from_raw(expected);
+                        taken->next.store(h.pointer(), std::memory_order_relaxed);
+                        if (head.compare_exchange_weak(expected, pair_type{ taken, h.integer() }.raw(), std::memory_order_release, std::memory_order_relaxed)) break;
+                        ++c.failures;
+                    }
+                    c.ops += 2;
+                }
+            }
+        }, seconds);
+    }
+
+    //
+    // Reporting
+    //
+
+    std::vector<std::size_t> thread_counts_up_to(std::size_t max_threads) {
+        std::vector<std::size_t> steps;
+        for (std::size_t t = 1; t < max_threads; t *= 2) steps.push_back(t);
+        steps.push_back(max_threads);
+        return steps;
+    }
+
+    void header(const char* workload) {
+        std::printf("%s\n", workload);
+        std::printf("  %-8s %8s %14s %10s %10s\n", "layout", "threads", "Mops/s", "scaling", "fail %");
+    }
+
+    void report(const char* layout, std::size_t threads, const counts &c, double seconds, double &baseline) {
+        auto mops = static_cast<double>(c.ops) / seconds / 1e6;
+        if (threads == 1) baseline = mops;
+        auto attempts = c.ops + c.failures;
+        std::printf("  %-8s %8zu %14.2f %9.2fx %10.2f\n",
+                    layout, threads, mops, baseline > 0 ? mops / baseline : 0.0,
+                    attempts > 0 ? 100.0 * static_cast<double>(c.failures) / static_cast<double>(attempts) : 0.0);
+    }
+
+    template <typename Run>
+    void bench_layouts(const char* workload, std::size_t max_threads, Run run) {
+        header(workload);
+        for (auto l : { layout::shared, layout::packed, layout::padded }) {
+            double baseline = 0;
+            for (auto threads : thread_counts_up_to(max_threads)) {
+                double seconds = 0;
+                auto c = run(l, threads, seconds);
+                report(layout_name(l), threads, c, seconds, baseline);
+            }
+        }
+        std::printf("\n");
+    }
+
+}
+
+int main(int argc, char** argv) {
+    std::string workload = argc > 1 ? argv[1] : "all";
+    std::size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+    unsigned millis = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 200;
+
+    if (max_threads == 0) max_threads = 1;
+    if (millis == 0) {
+        std::fprintf(stderr, "millis must be positive\n");
+        return 1;
+    }
+    if (workload != "load" && workload != "publish" && workload != "version" && workload != "treiber" && workload != "all") {
+        std::fprintf(stderr, "usage: %s [load|publish|version|treiber|all] [max_threads] [millis]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<node> nodes(max_threads);
+    auto initial = pair_type{ &nodes[0], 0 }.raw();
+
+    std::printf("up to %zu threads, %u ms per run\n\n", max_threads, millis);
+
+    if (workload == "load" || workload == "all") {
+        bench_layouts("atomic load", max_threads, [&](layout l, std::size_t threads, double &seconds) {
+            word_set words{ l, max_threads, initial };
+            return load_words(words, threads, millis, seconds);
+        });
+    }
+    if (workload == "publish" || workload == "all") {
+        bench_layouts("CAS publish pointer", max_threads, [&](layout l, std::size_t threads, double &seconds) {
+            word_set words{ l, max_threads, initial };
+            return publish_words(words, nodes, threads, millis, seconds);
+        });
+    }
+    if (workload == "version" || workload == "all") {
+        bench_layouts("CAS version tag increment", max_threads, [&](layout l, std::size_t threads, double &seconds) {
+            word_set words{ l, max_threads, initial };
+            return bump_versions(words, threads, millis, seconds);
+        });
+    }
+    if (workload == "treiber" || workload == "all") {
+        header("Treiber stack pop+push");
+        double baseline = 0;
+        for (auto threads : thread_counts_up_to(max_threads)) {
+            double seconds = 0;
+            auto c = treiber(threads, millis, seconds);
+            report("shared", threads, c, seconds, baseline);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
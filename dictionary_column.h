@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "immutable_string.h"
+#include "comparators.h"
+#include "bit_utils.h"
+#include "parallel.h"
+
+// A dictionary encoded string column: every distinct value is stored once as
+// a strong_immutable_string and each row is a 32 bit code into the
+// dictionary, assigned in order of first appearance. Equality filters turn
+// into a scan of the codes for a single value.
+
+namespace detail {
+
+    static constexpr std::size_t encode_min_chunk = 1 << 14;
+
+    inline std::size_t count_equal_codes(const std::uint32_t* first, const std::uint32_t* last, std::uint32_t code) noexcept {
+        std::size_t count = 0;
+#if defined(__AVX512F__)
+        const __m512i needle = _mm512_set1_epi32(static_cast<int>(code));
+        for (; last - first >= 16; first += 16) {
+            count += popcount32(_mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first), needle));
+        }
+#elif defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi32(static_cast<int>(code));
+        for (; last - first >= 8; first += 8) {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), needle);
+            count += popcount32(static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))));
+        }
+#endif
+        for (; first != last; ++first) {
+            count += *first == code;
+        }
+        return count;
+    }
+
+    // Writes row + i for every i where first[i] == code.
+    inline std::size_t* select_equal_codes(const std::uint32_t* first, const std::uint32_t* last, std::uint32_t code,
+                                           std::size_t row, std::size_t* out) noexcept
+    {
+#if defined(__AVX512F__)
+        const __m512i needle = _mm512_set1_epi32(static_cast<int>(code));
+        for (; last - first >= 16; first += 16, row += 16) {
+            for (unsigned m = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(first), needle); m != 0; m &= m - 1) {
+                *out++ = row + lowest_bit(m);
+            }
+        }
+#elif defined(__AVX2__)
+        const __m256i needle = _mm256_set1_epi32(static_cast<int>(code));
+        for (; last - first >= 8; first += 8, row += 8) {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), needle);
+            for (unsigned m = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))); m != 0; m &= m - 1) {
+                *out++ = row + lowest_bit(m);
+            }
+        }
+#endif
+        for (; first != last; ++first, ++row) {
+            if (*first == code) *out++ = row;
+        }
+        return out;
+    }
+
+    // A template so npos can be defined out of line in a header, which lets
+    // it be bound to references before C++17 made static constexpr members
+    // inline.
+    template <typename = void>
+    struct dictionary_column_constants {
+        static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+    };
+
+    template <typename Ignored>
+    constexpr std::uint32_t dictionary_column_constants<Ignored>::npos;
+
+}
+
+class dictionary_column : public detail::dictionary_column_constants<> {
+
+public:
+
+    using code_type = std::uint32_t;
+    using view_type = strong_immutable_string_impl;
+    using size_type = std::size_t;
+
+private:
+
+    struct key_equal {
+        inline bool operator()(const view_type &lhs, const view_type &rhs) const noexcept {
+            return string_compare_pendatic::eq(lhs, rhs);
+        }
+    };
+
+    // unique_ptr keeps the strings, and so the views in m_index, in place
+    // while the dictionary grows.
+    std::vector<std::unique_ptr<strong_immutable_string>> m_dictionary;
+    std::unordered_map<view_type, code_type, string_hash_pendatic, key_equal> m_index;
+    std::vector<code_type> m_codes;
+
+    template <typename Key>
+    static inline view_type view_of(const Key &key) {
+        return view_type{ key.data(), key.size() };
+    }
+
+    template <typename Key>
+    code_type intern(const Key &key) {
+        auto it = m_index.find(view_of(key));
+        if (it != m_index.end()) return it->second;
+
+        ASSERT(m_dictionary.size() < npos);
+        auto code = static_cast<code_type>(m_dictionary.size());
+        m_dictionary.push_back(std::make_unique<strong_immutable_string>(key.data(), key.size()));
+        m_index.emplace(view_type{ *m_dictionary.back() }, code);
+        return code;
+    }
+
+public:
+
+    dictionary_column() = default;
+
+    dictionary_column(const dictionary_column&) = delete;
+    dictionary_column &operator=(const dictionary_column&) = delete;
+
+    dictionary_column(dictionary_column&&) = default;
+    dictionary_column &operator=(dictionary_column&&) = default;
+
+    inline size_type size() const noexcept {
+        return m_codes.size();
+    }
+
+    NODISCARD inline bool empty() const noexcept {
+        return m_codes.empty();
+    }
+
+    inline size_type dictionary_size() const noexcept {
+        return m_dictionary.size();
+    }
+
+    inline const code_type* codes() const noexcept {
+        return m_codes.data();
+    }
+
+    void reserve(size_type rows) {
+        m_codes.reserve(rows);
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    void push_back(const Key &key) {
+        auto code = intern(key);
+        m_codes.push_back(code);
+    }
+
+    // Appends n rows. Keys already in the dictionary are looked up in
+    // parallel, split over threads (0 for every hardware thread); new ones
+    // are then added on the calling thread in row order, so the codes don't
+    // depend on the thread count.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    void encode_n(const Key* keys, size_type n, size_type threads = 0) {
+        auto base = m_codes.size();
+        m_codes.resize(base + n);
+        auto out = m_codes.data() + base;
+
+        try {
+            threads = detail::worker_count(threads, n, detail::encode_min_chunk);
+            detail::run_on_threads(threads, [&](std::size_t t) {
+                for (auto i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+                    auto it = m_index.find(view_of(keys[i]));
+                    out[i] = it != m_index.end() ? it->second : npos;
+                }
+            });
+
+            for (size_type i = 0; i < n; ++i) {
+                if (out[i] == npos) out[i] = intern(keys[i]);
+            }
+        }
+        catch (...) {
+            m_codes.resize(base);
+            throw;
+        }
+    }
+
+    // npos if key isn't in the dictionary.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline code_type code_of(const Key &key) const {
+        auto it = m_index.find(view_of(key));
+        return it != m_index.end() ? it->second : npos;
+    }
+
+    inline view_type decode(code_type code) const {
+        ASSERT(code < m_dictionary.size());
+        return view_type{ *m_dictionary[code] };
+    }
+
+    inline view_type operator[](size_type row) const {
+        ASSERT(row < size());
+        return decode(m_codes[row]);
+    }
+
+    // Writes views of rows [row, row + n) to out, e.g. a back_inserter, and
+    // returns the end of the output. The views stay valid as long as the
+    // column.
+    template <typename OutputIt>
+    OutputIt decode_n(size_type row, size_type n, OutputIt out) const {
+        ASSERT(row + n <= size());
+        for (auto code = m_codes.data() + row, last = code + n; code != last; ++code) {
+            *out++ = view_type{ *m_dictionary[*code] };
+        }
+        return out;
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    size_type count_equal(const Key &key) const {
+        auto code = code_of(key);
+        return code != npos ? detail::count_equal_codes(m_codes.data(), m_codes.data() + m_codes.size(), code) : 0;
+    }
+
+    // Writes the indices of the rows equal to key to out, which needs room
+    // for count_equal(key) entries, and returns the end of the output.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    size_type* select_equal(const Key &key, size_type* out) const {
+        auto code = code_of(key);
+        return code != npos ? detail::select_equal_codes(m_codes.data(), m_codes.data() + m_codes.size(), code, 0, out) : out;
+    }
+
+    // Number of rows per code, for group by.
+    std::vector<size_type> group_counts() const {
+        std::vector<size_type> counts(m_dictionary.size());
+        for (auto code : m_codes) {
+            ++counts[code];
+        }
+        return counts;
+    }
+};
@@ -0,0 +1,68 @@
+#include "test.h"
+#include "dictionary_column.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+TEST_CASE("dictionary column") {
+    GIVEN("rows pushed one at a time") {
+        dictionary_column column;
+        column.push_back(weak_immutable_string{ "red" });
+        column.push_back(weak_immutable_string{ "green" });
+        column.push_back(weak_immutable_string{ "red" });
+
+        CHECK(column.size() == 3);
+        CHECK(column.dictionary_size() == 2);
+        CHECK(column.codes()[0] == column.codes()[2]);
+        CHECK(string_compare_pendatic::eq(column[1], weak_immutable_string{ "green" }));
+        CHECK(column.code_of(weak_immutable_string{ "blue" }) == dictionary_column::npos);
+        CHECK(column.count_equal(weak_immutable_string{ "blue" }) == 0);
+    }
+
+    GIVEN("rows encoded in bulk") {
+        const char* values[] = { "alpha", "beta", "gamma", "delta", "epsilon", "" };
+        std::vector<weak_immutable_string_impl> keys;
+        for (std::size_t i = 0; i < 100003; ++i) {
+            keys.push_back(weak_immutable_string_impl{ values[(i * i + i / 7) % 6] });
+        }
+
+        dictionary_column single;
+        dictionary_column parallel;
+        single.encode_n(keys.data(), 1000, 1);
+        single.encode_n(keys.data() + 1000, keys.size() - 1000, 1);
+        parallel.encode_n(keys.data(), 1000, 4);
+        parallel.encode_n(keys.data() + 1000, keys.size() - 1000, 4);
+
+        REQUIRE(single.size() == keys.size());
+        REQUIRE(parallel.size() == keys.size());
+        CHECK(single.dictionary_size() == 6);
+        CHECK(std::equal(single.codes(), single.codes() + single.size(), parallel.codes()));
+
+        std::vector<strong_immutable_string_impl> decoded;
+        parallel.decode_n(0, keys.size(), std::back_inserter(decoded));
+        REQUIRE(decoded.size() == keys.size());
+        bool all_equal = true;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            all_equal = all_equal && string_compare_pendatic::eq(decoded[i], keys[i]);
+        }
+        CHECK(all_equal);
+
+        auto counts = parallel.group_counts();
+        for (auto value : values) {
+            weak_immutable_string_impl key{ value };
+            std::size_t expected = 0;
+            for (auto &k : keys) expected += string_compare_pendatic::eq(k, key);
+
+            CHECK(parallel.count_equal(key) == expected);
+            CHECK(counts[parallel.code_of(key)] == expected);
+
+            std::vector<std::size_t> rows(expected);
+            auto end = parallel.select_equal(key, rows.data());
+            CHECK(end == rows.data() + rows.size());
+            bool rows_match = std::is_sorted(rows.begin(), rows.end());
+            for (auto row : rows) rows_match = rows_match && string_compare_pendatic::eq(keys[row], key);
+            CHECK(rows_match);
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch based reclamation for lock-free readers. A reader pins the current
+// epoch for as long as it may hold pointers into shared structures; a writer
+// that unlinks an object retires it instead of deleting it. The global
+// epoch only advances once every pinned thread has seen it, so anything
+// retired two epochs back can no longer be reached and gets freed.
+//
+// There is a single process wide domain. Objects retired by a thread that
+// exits are handed over to whichever thread scans next.
+
+namespace epoch {
+
+    namespace detail {
+
+        struct retired {
+            void* ptr;
+            void (*deleter)(void*);
+            std::uint64_t epoch;
+        };
+
+        // Pinned threads publish (epoch << 1) | 1, quiescent ones 0.
+        struct thread_record {
+            std::atomic<std::uint64_t> state{ 0 };
+            std::atomic<bool> in_use{ true };
+            thread_record* next = nullptr;
+        };
+
+        struct domain {
+            std::atomic<std::uint64_t> global_epoch{ 1 };
+            std::atomic<thread_record*> records{ nullptr };
+
+            std::mutex orphans_mutex;
+            std::vector<retired> orphans;
+
+            ~domain() {
+                for (auto &r : orphans) r.deleter(r.ptr);
+                for (auto record = records.load(); record != nullptr;) {
+                    auto next = record->next;
+                    delete record;
+                    record = next;
+                }
+            }
+        };
+
+        inline domain &global_domain() {
+            static domain d;
+            return d;
+        }
+
+        static constexpr std::size_t scan_interval = 64;
+
+        // Frees every entry of list retired at least two epochs before
+        // epoch and keeps the rest.
+        inline void free_safe(std::vector<retired> &list, std::uint64_t epoch) {
+            auto keep = list.begin();
+            for (auto it = list.begin(); it != list.end(); ++it) {
+                if (it->epoch + 2 <= epoch) {
+                    it->deleter(it->ptr);
+                }
+                else {
+                    *keep++ = *it;
+                }
+            }
+            list.erase(keep, list.end());
+        }
+
+        inline std::uint64_t try_advance(domain &d) {
+            auto epoch = d.global_epoch.load(std::memory_order_seq_cst);
+            for (auto record = d.records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+                auto state = record->state.load(std::memory_order_seq_cst);
+                if ((state & 1) && (state >> 1) != epoch) return epoch;
+            }
+            d.global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+            return d.global_epoch.load(std::memory_order_seq_cst);
+        }
+
+        struct thread_state {
+            domain &d;
+            thread_record* record = nullptr;
+            unsigned nesting = 0;
+            std::size_t since_scan = 0;
+            std::vector<retired> limbo;
+
+            thread_state()
+            :d{ global_domain() }
+            {
+                for (auto r = d.records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+                    bool expected = false;
+                    if (r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                        record = r;
+                        return;
+                    }
+                }
+
+                record = new thread_record;
+                auto head = d.records.load(std::memory_order_relaxed);
+                do {
+                    record->next = head;
+                } while (!d.records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            ~thread_state() {
+                if (!limbo.empty()) {
+                    std::lock_guard<std::mutex> lock{ d.orphans_mutex };
+                    d.orphans.insert(d.orphans.end(), limbo.begin(), limbo.end());
+                }
+                record->state.store(0, std::memory_order_release);
+                record->in_use.store(false, std::memory_order_release);
+            }
+
+            void scan() {
+                since_scan = 0;
+                auto epoch = try_advance(d);
+                free_safe(limbo, epoch);
+
+                std::unique_lock<std::mutex> lock{ d.orphans_mutex, std::try_to_lock };
+                if (lock.owns_lock()) {
+                    free_safe(d.orphans, epoch);
+                }
+            }
+        };
+
+        inline thread_state &local() {
+            thread_local thread_state state;
+            return state;
+        }
+
+    }
+
+    // Keeps the calling thread pinned while alive. Guards nest.
+    class guard {
+
+        detail::thread_state* m_state;
+
+    public:
+
+        guard()
+        :m_state{ &detail::local() }
+        {
+            if (m_state->nesting++ > 0) return;
+
+            auto &global = m_state->d.global_epoch;
+            auto epoch = global.load(std::memory_order_seq_cst);
+            for (;;) {
+                m_state->record->state.store((epoch << 1) | 1, std::memory_order_seq_cst);
+                auto current = global.load(std::memory_order_seq_cst);
+                if (current == epoch) break;
+                epoch = current;
+            }
+        }
+
+        guard(const guard&) = delete;
+        guard &operator=(const guard&) = delete;
+
+        guard(guard &&other) noexcept
+        :m_state{ other.m_state }
+        {
+            other.m_state = nullptr;
+        }
+
+        ~guard() {
+            if (m_state != nullptr && --m_state->nesting == 0) {
+                m_state->record->state.store(0, std::memory_order_release);
+            }
+        }
+    };
+
+    // Frees ptr with deleter once no thread can still be reading it.
+    inline void retire(void* ptr, void (*deleter)(void*)) {
+        auto &state = detail::local();
+        state.limbo.push_back(detail::retired{ ptr, deleter, state.d.global_epoch.load(std::memory_order_seq_cst) });
+        if (++state.since_scan >= detail::scan_interval) {
+            state.scan();
+        }
+    }
+
+    template <typename T>
+    inline void retire(T* ptr) {
+        retire(static_cast<void*>(ptr), [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // Tries to advance the epoch and frees whatever has become safe. Mostly
+    // useful for tests and shutdown paths; retire() calls it periodically.
+    inline void collect() {
+        detail::local().scan();
+    }
+
+    // Number of objects retired by the calling thread and not yet freed.
+    inline std::size_t pending() {
+        return detail::local().limbo.size();
+    }
+
+}
@@ -0,0 +1,76 @@
+#include "test.h"
+#include "epoch_reclamation.h"
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+    std::atomic<int> freed{ 0 };
+
+    struct tracked {
+        ~tracked() {
+            ++freed;
+        }
+    };
+
+    void drain() {
+        for (int i = 0; i < 4 && epoch::pending() > 0; ++i) {
+            epoch::collect();
+        }
+    }
+
+}
+
+TEST_CASE("epoch reclamation") {
+    drain();
+    freed = 0;
+
+    GIVEN("no readers") {
+        epoch::retire(new tracked);
+        epoch::retire(new tracked);
+        CHECK(epoch::pending() == 2);
+
+        drain();
+        CHECK(epoch::pending() == 0);
+        CHECK(freed == 2);
+    }
+
+    GIVEN("a reader pinned on this thread") {
+        {
+            epoch::guard outer;
+            epoch::guard inner;
+            epoch::retire(new tracked);
+            drain();
+            CHECK(freed == 0);
+        }
+        drain();
+        CHECK(freed == 1);
+    }
+
+    GIVEN("a reader pinned on another thread") {
+        std::atomic<int> stage{ 0 };
+        std::thread reader{ [&] {
+            epoch::guard guard;
+            stage = 1;
+            while (stage != 2) std::this_thread::yield();
+        } };
+        while (stage != 1) std::this_thread::yield();
+
+        epoch::retire(new tracked);
+        drain();
+        CHECK(freed == 0);
+
+        stage = 2;
+        reader.join();
+        drain();
+        CHECK(freed == 1);
+    }
+
+    GIVEN("objects retired by an exited thread") {
+        std::thread{ [] { epoch::retire(new tracked); } }.join();
+
+        for (int i = 0; i < 4; ++i) epoch::collect();
+        CHECK(freed == 1);
+    }
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "immutable_string.h"
+#include "comparators.h"
+
+// A read-only sorted set of strings stored front coded: keys are grouped in
+// blocks, each block starts with its first key written out in full (and null
+// terminated, so it can be compared in place), and every following key is
+// stored as the length of the prefix it shares with the one before plus the
+// rest of its bytes. Lookups binary search the block heads and then decode at
+// most one block.
+//
+// Layout of a block, lengths as LEB128 varints:
+//     head_length head_bytes '\0' { shared_length suffix_length suffix_bytes }
+
+namespace detail {
+
+    inline void put_varint(std::vector<char> &out, std::size_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    inline std::size_t get_varint(const char* &in) noexcept {
+        std::size_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            auto byte = static_cast<unsigned char>(*in++);
+            value |= std::size_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+    }
+
+}
+
+class front_coded_set {
+
+public:
+
+    using size_type = std::size_t;
+    using view_type = weak_immutable_string_impl;
+
+    static constexpr size_type default_block_size = 32;
+
+private:
+
+    std::vector<char> m_data;
+    std::vector<size_type> m_blocks;
+    size_type m_size = 0;
+    size_type m_block_size = default_block_size;
+
+    inline strong_immutable_string_impl head(size_type block) const {
+        auto in = m_data.data() + m_blocks[block];
+        auto len = detail::get_varint(in);
+        return strong_immutable_string_impl{ in, static_cast<strong_immutable_string_impl::size_type>(len) };
+    }
+
+public:
+
+    // Walks the keys in order. Each key is decoded into a buffer owned by
+    // the iterator, so a view returned by operator* stays valid until the
+    // iterator moves or goes away.
+    class const_iterator {
+
+        const front_coded_set* m_set = nullptr;
+        size_type m_index = 0;
+        const char* m_next = nullptr;
+        std::string m_key;
+
+        friend class front_coded_set;
+
+        const_iterator(const front_coded_set* set, size_type index)
+        :m_set{ set }, m_index{ index }
+        {
+            if (m_index < m_set->m_size) load_head();
+        }
+
+        inline void load_head() {
+            m_next = m_set->m_data.data() + m_set->m_blocks[m_index / m_set->m_block_size];
+            auto len = detail::get_varint(m_next);
+            m_key.assign(m_next, len);
+            m_next += len + 1;
+        }
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = view_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const view_type*;
+        using reference = view_type;
+
+        const_iterator() = default;
+
+        inline view_type operator*() const {
+            return view_type{ m_key.c_str(), static_cast<view_type::size_type>(m_key.size()) };
+        }
+
+        // Rank of the current key in the set.
+        inline size_type index() const noexcept {
+            return m_index;
+        }
+
+        const_iterator &operator++() {
+            if (++m_index >= m_set->m_size) {
+                m_index = m_set->m_size;
+            }
+            else if (m_index % m_set->m_block_size == 0) {
+                load_head();
+            }
+            else {
+                auto shared = detail::get_varint(m_next);
+                auto len = detail::get_varint(m_next);
+                m_key.resize(shared);
+                m_key.append(m_next, len);
+                m_next += len;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        inline bool operator==(const const_iterator &other) const noexcept {
+            return m_index == other.m_index;
+        }
+
+        inline bool operator!=(const const_iterator &other) const noexcept {
+            return m_index != other.m_index;
+        }
+    };
+
+    using iterator = const_iterator;
+
+    front_coded_set() = default;
+
+    // Builds the set from keys sorted by string_compare_pendatic. Duplicate
+    // keys are stored once.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    front_coded_set(const Key* first, const Key* last, size_type block_size = default_block_size)
+    :m_block_size{ block_size }
+    {
+        ASSERT(block_size > 0);
+        ASSERT(std::is_sorted(first, last, [](const Key &lhs, const Key &rhs) { return string_compare_pendatic::lt(lhs, rhs); }));
+
+        const Key* previous = nullptr;
+        for (; first != last; ++first) {
+            if (previous != nullptr && string_compare_pendatic::eq(*previous, *first)) continue;
+
+            if (m_size % m_block_size == 0) {
+                m_blocks.push_back(m_data.size());
+                detail::put_varint(m_data, first->size());
+                m_data.insert(m_data.end(), first->data(), first->data() + first->size());
+                m_data.push_back('\0');
+            }
+            else {
+                auto limit = std::min(previous->size(), first->size());
+                size_type shared = std::mismatch(first->data(), first->data() + limit, previous->data()).first - first->data();
+                detail::put_varint(m_data, shared);
+                detail::put_varint(m_data, first->size() - shared);
+                m_data.insert(m_data.end(), first->data() + shared, first->data() + first->size());
+            }
+
+            previous = first;
+            ++m_size;
+        }
+        m_data.shrink_to_fit();
+        m_blocks.shrink_to_fit();
+    }
+
+    inline size_type size() const noexcept {
+        return m_size;
+    }
+
+    NODISCARD inline bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    inline size_type block_size() const noexcept {
+        return m_block_size;
+    }
+
+    // Bytes held by the encoded keys and the block index.
+    inline size_type memory_usage() const noexcept {
+        return m_data.capacity() + m_blocks.capacity() * sizeof(size_type);
+    }
+
+    const_iterator begin() const {
+        return const_iterator{ this, 0 };
+    }
+
+    const_iterator end() const {
+        return const_iterator{ this, m_size };
+    }
+
+    // First key not less than key.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    const_iterator lower_bound(const Key &key) const {
+        // Last block whose head is not greater than key.
+        size_type lo = 0;
+        size_type hi = m_blocks.size();
+        while (lo < hi) {
+            auto mid = lo + (hi - lo) / 2;
+            if (string_compare_pendatic::gt(head(mid), key)) {
+                hi = mid;
+            }
+            else {
+                lo = mid + 1;
+            }
+        }
+        if (lo == 0) return begin();
+
+        const_iterator it{ this, (lo - 1) * m_block_size };
+        auto block_end = std::min(lo * m_block_size, m_size);
+        while (it.m_index < block_end && string_compare_pendatic::lt(*it, key)) {
+            ++it;
+        }
+        return it;
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    const_iterator find(const Key &key) const {
+        auto it = lower_bound(key);
+        return it != end() && string_compare_pendatic::eq(*it, key) ? it : end();
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline bool contains(const Key &key) const {
+        return find(key) != end();
+    }
+};
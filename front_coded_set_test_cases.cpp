@@ -0,0 +1,72 @@
+#include "test.h"
+#include "front_coded_set.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    std::vector<std::string> vocabulary(std::size_t n) {
+        std::mt19937 rng{ 7 };
+        const char* stems[] = { "inter", "internal", "international", "pre", "prefix", "trans", "" };
+        std::vector<std::string> words;
+        for (std::size_t i = 0; i < n; ++i) {
+            std::string w = stems[rng() % 7];
+            for (auto len = rng() % 8; len > 0; --len) w += static_cast<char>('a' + rng() % 6);
+            words.push_back(w);
+        }
+        std::sort(words.begin(), words.end());
+        return words;
+    }
+
+}
+
+TEST_CASE("front coded set") {
+    GIVEN("an empty set") {
+        front_coded_set set;
+        CHECK(set.empty());
+        CHECK(set.begin() == set.end());
+        CHECK(!set.contains(weak_immutable_string{ "a" }));
+    }
+
+    GIVEN("a sorted vocabulary with duplicates") {
+        auto words = vocabulary(20000);
+        std::vector<weak_immutable_string> keys(words.begin(), words.end());
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        for (std::size_t block_size : { 1, 16, 64 }) {
+            front_coded_set set{ keys.data(), keys.data() + keys.size(), block_size };
+            REQUIRE(set.size() == words.size());
+
+            std::size_t i = 0;
+            bool in_order = true;
+            for (auto it = set.begin(); it != set.end(); ++it, ++i) {
+                in_order = in_order && it.index() == i && std::string{ (*it).data(), (*it).size() } == words[i];
+            }
+            CHECK(i == words.size());
+            CHECK(in_order);
+
+            bool all_found = true;
+            for (std::size_t j = 0; j < words.size(); j += 7) {
+                weak_immutable_string key{ words[j] };
+                auto it = set.find(key);
+                all_found = all_found && it != set.end() && it.index() == j;
+            }
+            CHECK(all_found);
+
+            weak_immutable_string missing{ "internalz" };
+            auto expected = std::lower_bound(words.begin(), words.end(), std::string{ "internalz" }) - words.begin();
+            CHECK(!set.contains(missing));
+            CHECK(set.lower_bound(missing).index() == static_cast<std::size_t>(expected));
+            CHECK(set.lower_bound(weak_immutable_string{ "zzz" }) == set.end());
+            CHECK(set.lower_bound(weak_immutable_string{ "" }) == set.begin());
+        }
+
+        front_coded_set set{ keys.data(), keys.data() + keys.size() };
+        std::size_t flat = 0;
+        for (auto &w : words) flat += w.size() + 1;
+        CHECK(set.memory_usage() < flat);
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ptr_int_pair_48va.h"
+
+template <typename T, std::size_t BlockSize = 1024>
+class generational_pool {
+
+public:
+
+    using value_type = T;
+    using size_type = std::size_t;
+    using generation_type = std::uint16_t;
+    using handle_type = ptr_int_pair_48va<T, generation_type>;
+
+    static_assert(BlockSize > 0, "BlockSize must be positive");
+
+private:
+
+    //
+    // Slot details
+    //
+
+    // Odd generations mark live slots and even generations free ones, so a
+    // handle (always odd) can only match the slot it was created from.
+    struct slot {
+        union storage_type {
+            alignas(T) unsigned char object[sizeof(T)];
+            slot* next_free;
+        } storage;
+        generation_type generation;
+    };
+
+    static_assert(std::is_standard_layout<slot>::value, "slot must be standard layout");
+
+    static constexpr generation_type max_generation = std::numeric_limits<generation_type>::max();
+
+    static inline bool is_live(const slot &s) noexcept {
+        return (s.generation & 1) != 0;
+    }
+
+    static inline T* object_of(slot &s) noexcept {
+        return reinterpret_cast<T*>(s.storage.object);
+    }
+
+    static inline slot* slot_of(T* ptr) noexcept {
+        // storage is the first member of slot
+        return reinterpret_cast<slot*>(ptr);
+    }
+
+    //
+    // Member variables
+    //
+
+    std::vector<std::unique_ptr<slot[]>> m_blocks;
+    slot* m_free_list = nullptr;
+    size_type m_size = 0;
+
+    void grow() {
+        std::unique_ptr<slot[]> block{ new slot[BlockSize] };
+        for (size_type i = BlockSize; i > 0; --i) {
+            slot &s = block[i - 1];
+            s.generation = 0;
+            s.storage.next_free = m_free_list;
+            m_free_list = &s;
+        }
+        m_blocks.push_back(std::move(block));
+    }
+
+    inline slot* lookup(handle_type handle) const noexcept {
+        T* ptr = handle.pointer();
+        if (ptr == nullptr) return nullptr;
+
+        slot* s = slot_of(ptr);
+        return s->generation == handle.integer() ? s : nullptr;
+    }
+
+public:
+
+    //
+    // Constructors
+    //
+
+    generational_pool() = default;
+
+    generational_pool(const generational_pool&) = delete;
+    generational_pool &operator=(const generational_pool&) = delete;
+
+    ~generational_pool() {
+        for (auto &block : m_blocks) {
+            for (size_type i = 0; i < BlockSize; ++i) {
+                if (is_live(block[i])) {
+                    object_of(block[i])->~T();
+                }
+            }
+        }
+    }
+
+    //
+    // Modifiers
+    //
+
+    template <typename... Args>
+    handle_type create(Args&&... args) {
+        if (m_free_list == nullptr) {
+            grow();
+        }
+
+        slot* s = m_free_list;
+        slot* next = s->storage.next_free;
+
+        ::new (static_cast<void*>(s->storage.object)) T(std::forward<Args>(args)...);
+
+        m_free_list = next;
+        ++s->generation;
+        ++m_size;
+        return handle_type{ object_of(*s), s->generation };
+    }
+
+    inline bool destroy(handle_type handle) noexcept {
+        slot* s = lookup(handle);
+        if (s == nullptr) return false;
+
+        object_of(*s)->~T();
+        --m_size;
+
+        // A slot whose generation would wrap is retired rather than reused,
+        // so a stale handle can never alias a later object.
+        if (s->generation == max_generation) {
+            s->generation = 0;
+            s->storage.next_free = nullptr;
+            return true;
+        }
+
+        ++s->generation;
+        s->storage.next_free = m_free_list;
+        m_free_list = s;
+        return true;
+    }
+
+    //
+    // Accessors
+    //
+
+    inline T* get(handle_type handle) const noexcept {
+        slot* s = lookup(handle);
+        return s != nullptr ? object_of(*s) : nullptr;
+    }
+
+    inline bool valid(handle_type handle) const noexcept {
+        return lookup(handle) != nullptr;
+    }
+
+    inline size_type size() const noexcept {
+        return m_size;
+    }
+
+    inline bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    inline size_type capacity() const noexcept {
+        return m_blocks.size() * BlockSize;
+    }
+};
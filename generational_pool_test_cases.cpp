@@ -0,0 +1,90 @@
+#include "test.h"
+#include "generational_pool.h"
+
+#include <string>
+#include <vector>
+
+TEST_CASE("generational pool") {
+    GIVEN("an empty pool") {
+        generational_pool<std::string, 4> pool;
+
+        CHECK(pool.empty());
+        CHECK(pool.capacity() == 0);
+        CHECK(pool.get({}) == nullptr);
+        CHECK(!pool.destroy({}));
+    }
+
+    GIVEN("create and destroy") {
+        generational_pool<std::string, 4> pool;
+
+        auto h = pool.create("foo");
+        REQUIRE(pool.valid(h));
+        CHECK(pool.size() == 1);
+        CHECK(pool.capacity() == 4);
+        CHECK(*pool.get(h) == "foo");
+        CHECK(pool.get(h) == h.pointer());
+
+        CHECK(pool.destroy(h));
+        CHECK(!pool.valid(h));
+        CHECK(pool.get(h) == nullptr);
+        CHECK(!pool.destroy(h));
+        CHECK(pool.empty());
+
+        SECTION("stale handle after slot reuse") {
+            auto g = pool.create("bar");
+            CHECK(g.pointer() == h.pointer());
+            CHECK(g.integer() != h.integer());
+            CHECK(pool.get(h) == nullptr);
+            CHECK(*pool.get(g) == "bar");
+        }
+    }
+
+    GIVEN("growth across blocks") {
+        generational_pool<int, 4> pool;
+        std::vector<generational_pool<int, 4>::handle_type> handles;
+
+        for (int i = 0; i < 10; ++i) {
+            handles.push_back(pool.create(i));
+        }
+
+        CHECK(pool.size() == 10);
+        CHECK(pool.capacity() == 12);
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(pool.get(handles[i]) != nullptr);
+            CHECK(*pool.get(handles[i]) == i);
+        }
+
+        for (int i = 0; i < 10; i += 2) {
+            CHECK(pool.destroy(handles[i]));
+        }
+        CHECK(pool.size() == 5);
+        for (int i = 0; i < 10; ++i) {
+            CHECK(pool.valid(handles[i]) == (i % 2 == 1));
+        }
+
+        for (int i = 0; i < 5; ++i) {
+            pool.create(100 + i);
+        }
+        CHECK(pool.capacity() == 12);
+    }
+
+    GIVEN("generation exhaustion") {
+        generational_pool<int, 1> pool;
+
+        auto first = pool.create(0);
+        auto h = first;
+        for (int i = 0; i < 32767; ++i) {
+            REQUIRE(pool.destroy(h));
+            h = pool.create(i);
+            REQUIRE(h.pointer() == first.pointer());
+        }
+
+        CHECK(h.integer() == std::numeric_limits<std::uint16_t>::max());
+        CHECK(pool.destroy(h));
+
+        auto fresh = pool.create(1);
+        CHECK(fresh.pointer() != first.pointer());
+        CHECK(pool.capacity() == 2);
+        CHECK(!pool.valid(first));
+    }
+}
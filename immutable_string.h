@@ -2,13 +2,16 @@
 
 #include <cassert>
 #include <cstring>
+#include <functional>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #ifdef __cpp_lib_string_view
 #include <string_view>
 #endif
 
 #include "ptr_int_pair_48va.h"
+#include "immutable_string_stats.h"
 
 #ifndef ASSERT
 #define ASSERT(X) assert(X)
@@ -37,6 +40,9 @@
 struct constexpr_op_t {};
 static constexpr constexpr_op_t constexpr_op;
 
+struct adopt_buffer_t {};
+static constexpr adopt_buffer_t adopt_buffer;
+
 template <typename CharType, bool StrongImmutability, typename Ignored>
 class basic_immutable_string_impl { basic_immutable_string_impl() = delete; };
 
@@ -104,7 +110,7 @@ namespace detail {
 }
 
 template <typename Lhs, typename Rhs>
-using is_comparable_as_immutable_strings = detail::is_comparable_as_immutable_strings<Lhs, Rhs, typename Lhs::value_type, 
+using is_comparable_as_immutable_strings = detail::is_comparable_as_immutable_strings<Lhs, Rhs, std::remove_const_t<typename Lhs::value_type>, 
                                                                                       typename detail::common_comparator_type<Lhs, Rhs>::type>;
 
 constexpr std::size_t ct_strlen(const char* str) {
@@ -133,6 +139,12 @@ public:
 
 protected:
 
+    template <typename, bool, typename>
+    friend class basic_immutable_string_impl;
+
+    template <typename, bool>
+    friend class basic_immutable_string;
+
     buffer_type m_buffer;
 
     template <typename T>
@@ -159,6 +171,8 @@ protected:
                                : throw std::out_of_range{ "" };
     }
 
+    constexpr basic_immutable_string_impl() noexcept = default;
+
     inline basic_immutable_string_impl(buffer_type buf) noexcept 
     :m_buffer{ buf }
     {}
@@ -166,7 +180,7 @@ protected:
 public:
 
     template <typename Traits, typename Allocator>
-    basic_immutable_string_impl(const std::basic_string<value_type, Traits, Allocator> &str)
+    basic_immutable_string_impl(const std::basic_string<char, Traits, Allocator> &str)
     :m_buffer{ str.c_str(), check_size(str.size()) }
     {}
 
@@ -188,12 +202,12 @@ public:
 
 #ifdef __cpp_lib_string_view
     template <typename Traits>
-    basic_immutable_string_impl(const std::basic_string_view<value_type, Traits> &view)
+    basic_immutable_string_impl(const std::basic_string_view<char, Traits> &view)
     :m_buffer{ check_null(view.data(), view.size()), check_size(view.size()) }
     {}
 
     template <typename Traits>
-    constexpr basic_immutable_string_impl(constexpr_op_t, const std::basic_string_view<value_type, Traits> &view)
+    constexpr basic_immutable_string_impl(constexpr_op_t, const std::basic_string_view<char, Traits> &view)
     :m_buffer{ ct_check_null(view.data(), view.size()), ct_check_size(view.size()) }
     {}
 #endif
@@ -205,7 +219,7 @@ public:
 
     template <typename Traits, typename Allocator, bool StrongImm = StrongImmutability>
     inline std::enable_if_t<!StrongImm, basic_immutable_string_impl&>
-    operator=(const std::basic_string<value_type, Traits, Allocator> &str) {
+    operator=(const std::basic_string<char, Traits, Allocator> &str) {
         m_buffer = buffer_type{ str.c_str(), check_size(str.size()) };
         return *this;
     }
@@ -217,8 +231,8 @@ public:
     }
 
 #ifdef __cpp_lib_string_view
-    template <typename Traits, typename = std::enable_if_t<!StrongImmutability>>
-    inline basic_immutable_string_impl &operator=(const std::basic_string_view<value_type, Traits> &view) {
+    template <typename Traits, bool StrongImm = StrongImmutability, typename = std::enable_if_t<!StrongImm>>
+    inline basic_immutable_string_impl &operator=(const std::basic_string_view<char, Traits> &view) {
         m_buffer = buffer_type{ check_null(view.data(), view.size()), check_size(view.size()) };
         return *this;
     }
@@ -323,10 +337,10 @@ template <bool StrongImmutability>
 class basic_immutable_string<char, StrongImmutability> : public basic_immutable_string_impl<char, StrongImmutability, void> {
 
     using base_type = basic_immutable_string_impl<char, StrongImmutability, void>;
-    using buffer_type = typename base_type::buffer_type;
 
 public:
 
+    using buffer_type = typename base_type::buffer_type;
     using value_type = typename base_type::value_type;
     using const_pointer = typename base_type::const_pointer;
     using size_type = typename base_type::size_type;
@@ -343,6 +357,7 @@ private:
 
         auto ptr = new char[sz + 1];
         ASSERT(ptr != nullptr);
+        IMMUTABLE_STRING_STATS(immutable_string_stats::record_allocation(sz));
 
         std::memcpy(ptr, str, sz);
         ptr[sz] = '\0';
@@ -352,11 +367,11 @@ private:
 public:
 
     constexpr basic_immutable_string()
-    :base_type::m_buffer{ null }
+    :base_type{ buffer_type{ null } }
     {}
 
     template <typename Traits, typename Allocator>
-    basic_immutable_string(const std::basic_string<value_type, Traits, Allocator> &str) {
+    basic_immutable_string(const std::basic_string<char, Traits, Allocator> &str) {
         allocate_and_copy(str.c_str(), base_type::check_size(str.size()));
     }
 
@@ -368,6 +383,7 @@ public:
 
         auto ptr = new char[sz + 1];
         ASSERT(ptr != nullptr);
+        IMMUTABLE_STRING_STATS(immutable_string_stats::record_allocation(sz));
 
         std::uninitialized_fill_n(ptr, sz, c);
         ptr[sz] = '\0';
@@ -384,7 +400,7 @@ public:
 
 #ifdef __cpp_lib_string_view
     template <typename Traits>
-    basic_immutable_string(const std::basic_string_view<value_type, Traits> &view) {
+    basic_immutable_string(const std::basic_string_view<char, Traits> &view) {
         allocate_and_copy(view.data(), base_type::check_size(view.size()));
     }
 #endif
@@ -393,27 +409,45 @@ public:
         allocate_and_copy(impl.data(), impl.size());
     }
 
-    basic_immutable_string(std::unique_ptr<char[]> &&uptr) {
+    basic_immutable_string(std::unique_ptr<char[]> &&uptr)
+    :base_type{ buffer_type{ null } }
+    {
         auto sz = base_type::check_size(std::strlen(uptr.get()));
         if (sz > 0) {
             base_type::m_buffer = buffer_type{ uptr.release(), sz };
         }
     }
 
-    basic_immutable_string(basic_immutable_string<char, false> &&other) noexcept {
-        base_type::m_buffer.swap(other.base_type::m_buffer);
+    basic_immutable_string(basic_immutable_string<char, false> &&other) noexcept
+    :base_type{ other.m_buffer }
+    {
+        other.m_buffer = buffer_type{ null };
     }
 
     basic_immutable_string(basic_immutable_string<char, true>&&) = delete;
 
+    // Takes ownership of a buffer obtained from release_buffer().
+    basic_immutable_string(adopt_buffer_t, buffer_type buf) noexcept
+    :base_type{ buf }
+    {}
+
     template <bool StrongImm = StrongImmutability>
     inline std::enable_if_t<!StrongImm, std::unique_ptr<char[]>> release() noexcept {
-        // We kinda own the data?
-        auto ptr = const_cast<char*>(base_type::data());
-        base_type::m_buffer.clear();
+        // Empty strings point at the static null and own nothing.
+        char* ptr = base_type::empty() ? nullptr : const_cast<char*>(base_type::data());
+        base_type::m_buffer = buffer_type{ null };
         return std::unique_ptr<char[]>{ ptr };
     }
 
+    // Like release(), but keeps the size and hands back the packed word,
+    // which can travel through anything that holds 8 bytes.
+    template <bool StrongImm = StrongImmutability>
+    inline std::enable_if_t<!StrongImm, buffer_type> release_buffer() noexcept {
+        auto buf = base_type::m_buffer;
+        base_type::m_buffer = buffer_type{ null };
+        return buf;
+    }
+
     template <bool StrongImm = StrongImmutability>
     inline std::enable_if_t<!StrongImm, basic_immutable_string&> operator=(basic_immutable_string<char, false> &&other) noexcept {
         release();
@@ -423,16 +457,18 @@ public:
 
     basic_immutable_string &operator=(basic_immutable_string<char, true> &&other) = delete;
 
+    // Strong strings can't be moved, so dup<true>() relies on C++17's
+    // guaranteed copy elision and needs C++17 to compile.
     template <bool StrongImm>
-    inline basic_immutable_string<char, StrongImm> dup() {
-        basic_immutable_string<char, StrongImm> tmp;
-        tmp.allocate_and_copy(base_type::c_str(), base_type::size());
-        return tmp;
+    inline basic_immutable_string<char, StrongImm> dup() const {
+        IMMUTABLE_STRING_STATS(immutable_string_stats::record_dup());
+        return basic_immutable_string<char, StrongImm>{ base_type::c_str(), base_type::size() };
     }
 
     ~basic_immutable_string() {
         auto sz = base_type::size();
         if (sz > 0) {
+            IMMUTABLE_STRING_STATS(immutable_string_stats::record_free(sz));
             delete[] base_type::data();
         }
     }
@@ -468,7 +504,7 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator<(const Lhs &lhs,
           const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return Comparator::lt(lhs, rhs);
 }
 template <typename Lhs, typename Rhs>
@@ -476,7 +512,7 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator>(const Lhs &lhs,
           const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return Comparator::gt(lhs, rhs);
 }
 template <typename Lhs, typename Rhs>
@@ -484,7 +520,7 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator>=(const Lhs &lhs,
            const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return !Comparator::lt(lhs, rhs);
 }
 template <typename Lhs, typename Rhs>
@@ -492,7 +528,7 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator<=(const Lhs &lhs,
            const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return !Comparator::gt(lhs, rhs);
 }
 template <typename Lhs, typename Rhs>
@@ -500,7 +536,7 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator==(const Lhs &lhs,
            const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return Comparator::eq(lhs, rhs);
 }
 template <typename Lhs, typename Rhs>
@@ -508,12 +544,61 @@ inline std::enable_if_t<is_comparable_as_immutable_strings<Lhs, Rhs>::value, boo
 operator!=(const Lhs &lhs,
            const Rhs &rhs) noexcept
 {
-    using Comparator = detail::common_comparator_type<Lhs, Rhs>;
+    using Comparator = typename detail::common_comparator_type<Lhs, Rhs>::type;
     return !Comparator::eq(lhs, rhs);
 }
 
+namespace detail {
+
+    // Reads up to eight bytes into one word in native byte order.
+    struct word_load {
+        inline std::uint64_t operator()(const char* str, std::size_t len) const noexcept {
+            std::uint64_t w = 0;
+            std::memcpy(&w, str, len);
+            return w;
+        }
+    };
+
+    // The multiply/xor word hash behind every string hash in the library.
+    // Load turns up to eight bytes into a word, so callers can fold case or
+    // assemble bytes during constant evaluation. The result still needs a
+    // final mix.
+    template <typename Load = word_load>
+    constexpr std::uint64_t word_hash(const char* str, std::size_t len, std::uint64_t seed, Load load = Load{}) noexcept {
+        constexpr std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+        std::uint64_t h = seed ^ (len * k);
+        for (; len >= 8; str += 8, len -= 8) {
+            h = (h ^ load(str, 8)) * k;
+            h ^= h >> 29;
+        }
+        return (h ^ load(str, len)) * k;
+    }
+
+    inline std::size_t immutable_string_hash(const char* str, std::size_t len) noexcept {
+        auto h = word_hash(str, len, 0);
+        return static_cast<std::size_t>(h ^ (h >> 32));
+    }
+
+}
+
 namespace std {
 
+    // Only for the default comparator; views with other comparators need a
+    // hash that agrees with their equality.
+    template <bool StrongImmutability>
+    struct hash<basic_immutable_string_impl<char, StrongImmutability, void>> {
+        inline std::size_t operator()(const basic_immutable_string_impl<char, StrongImmutability, void> &str) const noexcept {
+            return ::detail::immutable_string_hash(str.data(), str.size());
+        }
+    };
+
+    template <bool StrongImmutability>
+    struct hash<basic_immutable_string<char, StrongImmutability>> {
+        inline std::size_t operator()(const basic_immutable_string<char, StrongImmutability> &str) const noexcept {
+            return ::detail::immutable_string_hash(str.data(), str.size());
+        }
+    };
+
     template <typename CharType, typename Traits, bool StrongImmutability, typename Ignored>
     inline std::basic_ostream<CharType, Traits> &operator<<(std::basic_ostream<CharType, Traits> &os, 
                                                             const basic_immutable_string_impl<CharType, StrongImmutability, Ignored> &str)
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+#include "immutable_string.h"
+
+// Numeric parsing and formatting straight on immutable strings, using the
+// stored length instead of scanning for the terminator and never going
+// through the locale. Integers are read eight digits at a time with SWAR
+// arithmetic. Doubles whose decimal mantissa and exponent are small enough
+// to be converted exactly take a fast path; everything else (long
+// mantissas, large exponents, inf and nan) goes to std::from_chars, or
+// std::strtod where that isn't available.
+//
+// The accepted syntax is that of std::from_chars: an optional '-', no
+// leading '+' or whitespace, and the whole string must be consumed.
+
+namespace detail {
+
+    inline bool all_digits8(std::uint64_t chunk) noexcept {
+        return ((chunk & 0xf0f0f0f0f0f0f0f0ULL) | (((chunk + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4)) == 0x3333333333333333ULL;
+    }
+
+    // Value of eight ASCII digits, the first one in the lowest byte.
+    inline std::uint32_t parse_digits8(std::uint64_t chunk) noexcept {
+        constexpr std::uint64_t mask = 0x000000ff000000ffULL;
+        constexpr std::uint64_t mul1 = 100 + (1000000ULL << 32);
+        constexpr std::uint64_t mul2 = 1 + (10000ULL << 32);
+        chunk -= 0x3030303030303030ULL;
+        chunk = (chunk * 10) + (chunk >> 8);
+        return static_cast<std::uint32_t>((((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32);
+    }
+
+    inline bool is_digit(char c) noexcept {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    // Appends up to max_digits digits from p to value, stopping at a non
+    // digit or end. value * 10^max_digits must stay below 10^19 so nothing
+    // can overflow. Returns the number of digits consumed; p stops at the
+    // first one left over.
+    inline int parse_digits(const char* &p, const char* end, std::uint64_t &value, int max_digits = 19) noexcept {
+        int count = 0;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        while (end - p >= 8 && count <= max_digits - 8) {
+            std::uint64_t chunk;
+            std::memcpy(&chunk, p, 8);
+            if (!all_digits8(chunk)) break;
+            value = value * 100000000 + parse_digits8(chunk);
+            p += 8;
+            count += 8;
+        }
+#endif
+        for (; p != end && is_digit(*p) && count < max_digits; ++p, ++count) {
+            value = value * 10 + static_cast<std::uint64_t>(*p - '0');
+        }
+        return count;
+    }
+
+    template <typename T>
+    bool parse_int(const char* p, const char* end, T &out) noexcept {
+        using unsigned_type = std::make_unsigned_t<T>;
+
+        bool negative = p != end && *p == '-';
+        if (negative) {
+            if (!std::is_signed<T>::value) return false;
+            ++p;
+        }
+        if (p == end) return false;
+
+        while (end - p > 1 && *p == '0') ++p;
+
+        std::uint64_t value = 0;
+        parse_digits(p, end, value);
+        if (p != end) {
+            // A 20th digit might still fit in 64 bits.
+            if (!is_digit(*p) || end - p > 1) return false;
+            auto digit = static_cast<std::uint64_t>(*p - '0');
+            if (value > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) return false;
+            value = value * 10 + digit;
+        }
+
+        std::uint64_t limit = std::numeric_limits<unsigned_type>::max();
+        if (std::is_signed<T>::value) {
+            limit = static_cast<std::uint64_t>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+        }
+        if (value > limit) return false;
+
+        out = negative ? static_cast<T>(std::uint64_t(0) - value) : static_cast<T>(value);
+        return true;
+    }
+
+    // Exact powers of ten up to the largest a double holds exactly.
+    static constexpr double exact_powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // str must be null terminated at end, which immutable strings are.
+    inline bool parse_double_slow(const char* str, const char* end, double &out) noexcept {
+#if defined(__cpp_lib_to_chars)
+        auto result = std::from_chars(str, end, out);
+        return result.ec == std::errc{} && result.ptr == end;
+#else
+        if (str == end || *str == '+' || std::isspace(static_cast<unsigned char>(*str))) return false;
+        char* stop = nullptr;
+        errno = 0;
+        out = std::strtod(str, &stop);
+        return stop == end && errno != ERANGE;
+#endif
+    }
+
+    inline bool parse_double(const char* str, const char* end, double &out) noexcept {
+        auto p = str;
+        bool negative = p != end && *p == '-';
+        if (negative) ++p;
+
+        std::uint64_t mantissa = 0;
+        auto int_begin = p;
+        while (p != end && *p == '0') ++p;
+        int digits = parse_digits(p, end, mantissa);
+        bool any_digits = p != int_begin;
+        int exponent = 0;
+
+        if (p != end && *p == '.') {
+            ++p;
+            auto frac_begin = p;
+            if (digits == 0) {
+                while (p != end && *p == '0') ++p;
+                exponent -= static_cast<int>(p - frac_begin);
+            }
+            auto before = p;
+            digits += parse_digits(p, end, mantissa, 19 - digits);
+            exponent -= static_cast<int>(p - before);
+            any_digits = any_digits || p != frac_begin;
+        }
+        if (!any_digits) return parse_double_slow(str, end, out);
+        if (p != end && is_digit(*p)) return parse_double_slow(str, end, out);
+
+        if (p != end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool exp_negative = p != end && *p == '-';
+            if (p != end && (*p == '-' || *p == '+')) ++p;
+            std::uint64_t e = 0;
+            auto before = p;
+            parse_digits(p, end, e);
+            if (p == before || p != end || e > 1000) return parse_double_slow(str, end, out);
+            exponent += exp_negative ? -static_cast<int>(e) : static_cast<int>(e);
+        }
+        if (p != end) return false;
+
+        if (mantissa == 0) {
+            out = negative ? -0.0 : 0.0;
+            return true;
+        }
+        if (mantissa > (std::uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+            return parse_double_slow(str, end, out);
+        }
+
+        auto value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / exact_powers_of_ten[-exponent] : value * exact_powers_of_ten[exponent];
+        out = negative ? -value : value;
+        return true;
+    }
+
+    template <typename T>
+    inline bool parse_number(const char* p, const char* end, T &out) noexcept {
+        return parse_int(p, end, out);
+    }
+
+    inline bool parse_number(const char* p, const char* end, double &out) noexcept {
+        return parse_double(p, end, out);
+    }
+
+    inline int count_digits(std::uint64_t value) noexcept {
+        int count = 1;
+        for (; value >= 10000; value /= 10000) count += 4;
+        if (value >= 1000) return count + 3;
+        if (value >= 100) return count + 2;
+        if (value >= 10) return count + 1;
+        return count;
+    }
+
+    // Room for len characters and the terminator, counted like any other
+    // immutable string allocation since adopt_chars hands it to one.
+    inline char* allocate_chars(std::size_t len) {
+        auto ptr = new char[len + 1];
+        IMMUTABLE_STRING_STATS(immutable_string_stats::record_allocation(len));
+        return ptr;
+    }
+
+    inline weak_immutable_string adopt_chars(char* ptr, std::size_t len) noexcept {
+        ptr[len] = '\0';
+        return weak_immutable_string{ adopt_buffer, weak_immutable_string::buffer_type{ ptr, static_cast<weak_immutable_string::size_type>(len) } };
+    }
+
+}
+
+// True if the whole of str is an integer that fits in T; out is only
+// written on success.
+template <typename T, typename Str, typename = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                                                ::is_comparable_as_immutable_strings<Str, strong_immutable_string_impl>::value>>
+inline bool parse_int(const Str &str, T &out) noexcept {
+    return detail::parse_int(str.data(), str.data() + str.size(), out);
+}
+
+template <typename Str, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Str, strong_immutable_string_impl>::value>>
+inline bool parse_double(const Str &str, double &out) noexcept {
+    return detail::parse_double(str.data(), str.data() + str.size(), out);
+}
+
+// Parses n strings into out, integers or doubles depending on T, and
+// returns how many were parsed before the first one that isn't a valid T.
+template <typename T, typename Str, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Str, strong_immutable_string_impl>::value>>
+std::size_t parse_n(const Str* first, std::size_t n, T* out) noexcept {
+    static_assert(std::is_same<T, double>::value || (std::is_integral<T>::value && !std::is_same<T, bool>::value),
+                  "parse_n supports integers and double");
+
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!detail::parse_number(first[i].data(), first[i].data() + first[i].size(), out[i])) return i;
+    }
+    return n;
+}
+
+// Formats value into a string of exactly its length, with one allocation.
+template <typename T, typename = std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+weak_immutable_string to_immutable_string(T value) {
+    bool negative = value < 0;
+    auto magnitude = negative ? std::uint64_t(0) - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+    auto len = static_cast<std::size_t>(detail::count_digits(magnitude)) + negative;
+
+    auto ptr = detail::allocate_chars(len);
+    auto p = ptr + len;
+    for (; magnitude >= 100; magnitude /= 100) {
+        auto pair = static_cast<unsigned>(magnitude % 100);
+        *--p = static_cast<char>('0' + pair % 10);
+        *--p = static_cast<char>('0' + pair / 10);
+    }
+    if (magnitude >= 10) {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    *--p = static_cast<char>('0' + magnitude);
+    if (negative) *--p = '-';
+    return detail::adopt_chars(ptr, len);
+}
+
+// Shortest representation that parses back to the same value where
+// std::to_chars is available, %.17g otherwise.
+inline weak_immutable_string to_immutable_string(double value) {
+    char buffer[32];
+#if defined(__cpp_lib_to_chars)
+    auto len = static_cast<std::size_t>(std::to_chars(buffer, buffer + sizeof(buffer), value).ptr - buffer);
+#else
+    auto len = static_cast<std::size_t>(std::snprintf(buffer, sizeof(buffer), "%.17g", value));
+#endif
+    auto ptr = detail::allocate_chars(len);
+    std::memcpy(ptr, buffer, len);
+    return detail::adopt_chars(ptr, len);
+}
@@ -0,0 +1,202 @@
+#include "test.h"
+#include "immutable_string_numeric.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+    template <typename T>
+    bool parses_to(const char* str, T expected) {
+        T value{};
+        return parse_int(weak_immutable_string{ str }, value) && value == expected;
+    }
+
+    template <typename T>
+    bool rejects(const char* str) {
+        T value{ 42 };
+        return !parse_int(weak_immutable_string{ str }, value) && value == 42;
+    }
+
+    bool parses_double_to(const char* str, double expected) {
+        double value = 0;
+        return parse_double(weak_immutable_string{ str }, value) && std::memcmp(&value, &expected, sizeof(double)) == 0;
+    }
+
+    bool rejects_double(const char* str) {
+        double value = 0;
+        return !parse_double(weak_immutable_string{ str }, value);
+    }
+
+}
+
+TEST_CASE("immutable string integer parsing") {
+    GIVEN("valid integers") {
+        CHECK(parses_to<int>("0", 0));
+        CHECK(parses_to<int>("7", 7));
+        CHECK(parses_to<int>("-7", -7));
+        CHECK(parses_to<int>("000123", 123));
+        CHECK(parses_to<int>("12345678", 12345678));
+        CHECK(parses_to<long long>("123456789012345678", 123456789012345678LL));
+        CHECK(parses_to<long long>("-9223372036854775808", std::numeric_limits<long long>::min()));
+        CHECK(parses_to<long long>("9223372036854775807", std::numeric_limits<long long>::max()));
+        CHECK(parses_to<std::uint64_t>("18446744073709551615", std::numeric_limits<std::uint64_t>::max()));
+        CHECK(parses_to<std::uint64_t>("0000000000000000000000018446744073709551615", std::numeric_limits<std::uint64_t>::max()));
+        CHECK(parses_to<std::int8_t>("-128", std::int8_t(-128)));
+        CHECK(parses_to<std::uint16_t>("65535", std::uint16_t(65535)));
+    }
+
+    GIVEN("invalid or out of range integers") {
+        CHECK(rejects<int>(""));
+        CHECK(rejects<int>("-"));
+        CHECK(rejects<int>("+1"));
+        CHECK(rejects<int>(" 1"));
+        CHECK(rejects<int>("1 "));
+        CHECK(rejects<int>("12a4"));
+        CHECK(rejects<int>("1234567a"));
+        CHECK(rejects<int>("2147483648"));
+        CHECK(rejects<int>("-2147483649"));
+        CHECK(rejects<unsigned>("-1"));
+        CHECK(rejects<unsigned>("-0"));
+        CHECK(rejects<std::int8_t>("128"));
+        CHECK(rejects<std::uint64_t>("18446744073709551616"));
+        CHECK(rejects<std::uint64_t>("99999999999999999999"));
+        CHECK(rejects<std::uint64_t>("123456789012345678901"));
+        CHECK(rejects<long long>("9223372036854775808"));
+    }
+
+    GIVEN("random values") {
+        std::mt19937_64 rng{ 49 };
+        for (int i = 0; i < 2000; ++i) {
+            auto value = static_cast<long long>(rng()) >> (rng() % 64);
+            long long parsed = 0;
+            auto str = std::to_string(value);
+            CHECK(parse_int(weak_immutable_string{ str.c_str() }, parsed));
+            CHECK(parsed == value);
+        }
+    }
+
+    GIVEN("a string with a shared buffer") {
+        strong_immutable_string str{ "31337" };
+        int value = 0;
+        CHECK(parse_int(str, value));
+        CHECK(value == 31337);
+    }
+}
+
+TEST_CASE("immutable string double parsing") {
+    GIVEN("values on the fast path") {
+        CHECK(parses_double_to("0", 0.0));
+        CHECK(parses_double_to("-0", -0.0));
+        CHECK(parses_double_to("1.5", 1.5));
+        CHECK(parses_double_to("-2.25", -2.25));
+        CHECK(parses_double_to("0.1", 0.1));
+        CHECK(parses_double_to(".5", 0.5));
+        CHECK(parses_double_to("3.", 3.0));
+        CHECK(parses_double_to("1e10", 1e10));
+        CHECK(parses_double_to("1.25E-3", 1.25e-3));
+        CHECK(parses_double_to("6.02e+22", 6.02e22));
+        CHECK(parses_double_to("0.000000123", 0.000000123));
+        CHECK(parses_double_to("123456789.123456", 123456789.123456));
+    }
+
+    GIVEN("values that need the slow path") {
+        CHECK(parses_double_to("1e300", 1e300));
+        CHECK(parses_double_to("2.2250738585072014e-308", 2.2250738585072014e-308));
+        CHECK(parses_double_to("0.30000000000000004441", 0.30000000000000004441));
+        CHECK(parses_double_to("12345678901234567890123", 12345678901234567890123.0));
+        CHECK(parses_double_to("9007199254740993", 9007199254740993.0));
+
+        double value = 0;
+        CHECK(parse_double(weak_immutable_string{ "inf" }, value));
+        CHECK(value == std::numeric_limits<double>::infinity());
+        CHECK(parse_double(weak_immutable_string{ "nan" }, value));
+        CHECK(value != value);
+    }
+
+    GIVEN("invalid doubles") {
+        CHECK(rejects_double(""));
+        CHECK(rejects_double("-"));
+        CHECK(rejects_double("."));
+        CHECK(rejects_double("+1"));
+        CHECK(rejects_double(" 1"));
+        CHECK(rejects_double("1.5x"));
+        CHECK(rejects_double("1e"));
+        CHECK(rejects_double("1e+"));
+        CHECK(rejects_double("1.2.3"));
+    }
+
+    GIVEN("random values") {
+        std::mt19937_64 rng{ 490 };
+        char buffer[64];
+        for (int i = 0; i < 2000; ++i) {
+            auto digits = static_cast<int>(rng() % 17) + 1;
+            auto exponent = static_cast<int>(rng() % 60) - 30;
+            std::snprintf(buffer, sizeof(buffer), "%.*e", digits, static_cast<double>(rng() % 1000000007) * 1.000001);
+            std::string str = buffer;
+            str = str.substr(0, str.find('e')) + "e" + std::to_string(exponent);
+
+            double value = 0;
+            CHECK(parse_double(weak_immutable_string{ str.c_str() }, value));
+            CHECK(value == std::strtod(str.c_str(), nullptr));
+        }
+    }
+}
+
+TEST_CASE("immutable string batch parsing") {
+    std::vector<weak_immutable_string> strs;
+    for (auto s : { "1", "-22", "333", "4444", "x", "6" }) strs.emplace_back(s);
+
+    GIVEN("integers") {
+        int out[6] = {};
+        CHECK(parse_n(strs.data(), 4, out) == 4);
+        CHECK(out[0] == 1);
+        CHECK(out[1] == -22);
+        CHECK(out[3] == 4444);
+        CHECK(parse_n(strs.data(), strs.size(), out) == 4);
+    }
+
+    GIVEN("doubles") {
+        double out[6] = {};
+        CHECK(parse_n(strs.data(), strs.size(), out) == 4);
+        CHECK(out[2] == 333.0);
+    }
+}
+
+TEST_CASE("immutable string formatting") {
+    GIVEN("integers") {
+        CHECK(std::strcmp(to_immutable_string(0).c_str(), "0") == 0);
+        CHECK(std::strcmp(to_immutable_string(-5).c_str(), "-5") == 0);
+        CHECK(std::strcmp(to_immutable_string(std::uint8_t(255)).c_str(), "255") == 0);
+
+        std::mt19937_64 rng{ 4900 };
+        for (int i = 0; i < 2000; ++i) {
+            auto value = static_cast<long long>(rng()) >> (rng() % 64);
+            auto str = to_immutable_string(value);
+            auto expected = std::to_string(value);
+            CHECK(str.size() == expected.size());
+            CHECK(std::strcmp(str.c_str(), expected.c_str()) == 0);
+        }
+
+        auto min = to_immutable_string(std::numeric_limits<long long>::min());
+        CHECK(std::strcmp(min.c_str(), "-9223372036854775808") == 0);
+        auto max = to_immutable_string(std::numeric_limits<std::uint64_t>::max());
+        CHECK(std::strcmp(max.c_str(), "18446744073709551615") == 0);
+    }
+
+    GIVEN("doubles") {
+        for (auto value : { 0.0, -1.5, 0.1, 1e300, 2.2250738585072014e-308, 123456.789 }) {
+            auto str = to_immutable_string(value);
+            CHECK(str.size() == std::strlen(str.c_str()));
+            double back = 0;
+            CHECK(parse_double(str, back));
+            CHECK(back == value);
+        }
+    }
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Allocation and comparison counters for immutable strings. The hooks in
+// immutable_string.h, comparators.h and immutable_string_numeric.h only exist
+// when IMMUTABLE_STRING_ENABLE_STATS is defined; it must be defined the same
+// way in every translation unit of a program.
+//
+// Each thread bumps its own counters with relaxed loads and stores (no
+// read-modify-write), and snapshot() sums the live threads plus whatever
+// exited threads left behind.
+
+#ifdef IMMUTABLE_STRING_ENABLE_STATS
+#define IMMUTABLE_STRING_STATS(X) X
+#else
+#define IMMUTABLE_STRING_STATS(X)
+#endif
+
+#define IMMUTABLE_STRING_STATS_COMPARE(POLICY, OP, LHS, RHS) \
+    IMMUTABLE_STRING_STATS(immutable_string_stats::record_compare(immutable_string_stats::policy::POLICY, \
+                                                                  immutable_string_stats::operation::OP, \
+                                                                  (LHS).c_str() == (RHS).c_str(), \
+                                                                  std::min<std::size_t>((LHS).size(), (RHS).size())))
+
+namespace immutable_string_stats {
+
+    enum class policy : std::size_t { loose, weak, safe, pendatic, ascii_icase, count };
+    enum class operation : std::size_t { lt, gt, eq, count };
+
+    static constexpr std::size_t policy_count = static_cast<std::size_t>(policy::count);
+    static constexpr std::size_t operation_count = static_cast<std::size_t>(operation::count);
+
+    // Bucket i counts lengths in [2^(i-1), 2^i); bucket 0 counts empty strings.
+    static constexpr std::size_t histogram_buckets = 17;
+
+    inline std::size_t histogram_bucket(std::size_t len) noexcept {
+        std::size_t bucket = 0;
+        while (len != 0 && bucket + 1 < histogram_buckets) {
+            len >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    struct counters {
+        std::uint64_t allocations = 0;
+        std::uint64_t allocated_bytes = 0;
+        std::uint64_t frees = 0;
+        std::uint64_t freed_bytes = 0;
+        std::uint64_t dups = 0;
+        std::uint64_t allocation_lengths[histogram_buckets] = {};
+
+        // Indexed by [policy][operation]
+        std::uint64_t fast_path[policy_count][operation_count] = {};
+        std::uint64_t full_compare[policy_count][operation_count] = {};
+        // Indexed by [policy][bucket of the shorter operand]
+        std::uint64_t compare_lengths[policy_count][histogram_buckets] = {};
+    };
+
+    namespace detail {
+
+        using counter_type = std::atomic<std::uint64_t>;
+
+        struct thread_counters {
+            counter_type allocations{ 0 };
+            counter_type allocated_bytes{ 0 };
+            counter_type frees{ 0 };
+            counter_type freed_bytes{ 0 };
+            counter_type dups{ 0 };
+            counter_type allocation_lengths[histogram_buckets] = {};
+            counter_type fast_path[policy_count][operation_count] = {};
+            counter_type full_compare[policy_count][operation_count] = {};
+            counter_type compare_lengths[policy_count][histogram_buckets] = {};
+
+            thread_counters();
+            ~thread_counters();
+        };
+
+        inline void bump(counter_type &c, std::uint64_t n = 1) noexcept {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        inline std::uint64_t read(const counter_type &c) noexcept {
+            return c.load(std::memory_order_relaxed);
+        }
+
+        inline void add_to(counters &total, const thread_counters &t) noexcept {
+            total.allocations += read(t.allocations);
+            total.allocated_bytes += read(t.allocated_bytes);
+            total.frees += read(t.frees);
+            total.freed_bytes += read(t.freed_bytes);
+            total.dups += read(t.dups);
+            for (std::size_t b = 0; b < histogram_buckets; ++b) {
+                total.allocation_lengths[b] += read(t.allocation_lengths[b]);
+            }
+            for (std::size_t p = 0; p < policy_count; ++p) {
+                for (std::size_t o = 0; o < operation_count; ++o) {
+                    total.fast_path[p][o] += read(t.fast_path[p][o]);
+                    total.full_compare[p][o] += read(t.full_compare[p][o]);
+                }
+                for (std::size_t b = 0; b < histogram_buckets; ++b) {
+                    total.compare_lengths[p][b] += read(t.compare_lengths[p][b]);
+                }
+            }
+        }
+
+        struct registry {
+            std::mutex mutex;
+            std::vector<const thread_counters*> live;
+            counters retired;
+        };
+
+        inline registry &global_registry() {
+            static registry r;
+            return r;
+        }
+
+        inline thread_counters::thread_counters() {
+            auto &r = global_registry();
+            std::lock_guard<std::mutex> lock{ r.mutex };
+            r.live.push_back(this);
+        }
+
+        inline thread_counters::~thread_counters() {
+            auto &r = global_registry();
+            std::lock_guard<std::mutex> lock{ r.mutex };
+            add_to(r.retired, *this);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+        }
+
+        inline thread_counters &local() {
+            thread_local thread_counters t;
+            return t;
+        }
+
+    }
+
+    inline void record_allocation(std::size_t len) {
+        auto &t = detail::local();
+        detail::bump(t.allocations);
+        detail::bump(t.allocated_bytes, len + 1);
+        detail::bump(t.allocation_lengths[histogram_bucket(len)]);
+    }
+
+    inline void record_free(std::size_t len) {
+        auto &t = detail::local();
+        detail::bump(t.frees);
+        detail::bump(t.freed_bytes, len + 1);
+    }
+
+    inline void record_dup() {
+        detail::bump(detail::local().dups);
+    }
+
+    inline void record_compare(policy p, operation op, bool fast_path, std::size_t len) {
+        auto &t = detail::local();
+        auto pi = static_cast<std::size_t>(p);
+        auto oi = static_cast<std::size_t>(op);
+        detail::bump(fast_path ? t.fast_path[pi][oi] : t.full_compare[pi][oi]);
+        detail::bump(t.compare_lengths[pi][histogram_bucket(len)]);
+    }
+
+    inline counters snapshot() {
+        auto &r = detail::global_registry();
+        std::lock_guard<std::mutex> lock{ r.mutex };
+
+        counters total = r.retired;
+        for (auto t : r.live) {
+            detail::add_to(total, *t);
+        }
+        return total;
+    }
+
+}
@@ -0,0 +1,101 @@
+// Checks the hooks compiled into immutable_string.h, comparators.h and
+// immutable_string_numeric.h when IMMUTABLE_STRING_ENABLE_STATS is defined.
+// The macro has to be the same in every translation unit of a program, so
+// this is its own test program rather than one of the *_test_cases.cpp files
+// linked with test.cpp.
+
+#define IMMUTABLE_STRING_ENABLE_STATS
+#define CATCH_CONFIG_MAIN
+#include "test.h"
+#include "immutable_string.h"
+#include "comparators.h"
+#include "immutable_string_numeric.h"
+
+#include <string>
+
+using namespace immutable_string_stats;
+
+TEST_CASE("stats hooks in immutable strings") {
+    GIVEN("allocations and frees") {
+        const auto before = snapshot();
+        {
+            weak_immutable_string hello{ "hello" };
+            strong_immutable_string filled(3, 'x');
+            weak_immutable_string empty{ "" };
+            auto copy = hello.dup<true>();
+
+            const auto during = snapshot();
+            CHECK(during.allocations - before.allocations == 3);
+            CHECK(during.allocated_bytes - before.allocated_bytes == 6 + 4 + 6);
+            CHECK(during.dups - before.dups == 1);
+            CHECK(during.frees - before.frees == 0);
+            CHECK(during.allocation_lengths[histogram_bucket(5)] - before.allocation_lengths[histogram_bucket(5)] == 2);
+            CHECK(during.allocation_lengths[histogram_bucket(3)] - before.allocation_lengths[histogram_bucket(3)] == 1);
+        }
+        const auto after = snapshot();
+
+        CHECK(after.frees - before.frees == 3);
+        CHECK(after.freed_bytes - before.freed_bytes == after.allocated_bytes - before.allocated_bytes);
+    }
+
+    GIVEN("a buffer that changes hands") {
+        const auto before = snapshot();
+        {
+            weak_immutable_string s{ std::string{ "moved" } };
+            weak_immutable_string m{ std::move(s) };
+            auto uptr = m.release();
+            weak_immutable_string back{ std::move(uptr) };
+        }
+        const auto after = snapshot();
+
+        CHECK(after.allocations - before.allocations == 1);
+        CHECK(after.frees - before.frees == 1);
+        CHECK(after.freed_bytes - before.freed_bytes == 6);
+    }
+
+    GIVEN("formatted numbers") {
+        const auto before = snapshot();
+        {
+            auto i = to_immutable_string(-1234);
+            auto d = to_immutable_string(0.5);
+            const auto during = snapshot();
+            CHECK(std::string{ i.c_str() } == "-1234");
+            CHECK(std::string{ d.c_str() } == "0.5");
+            CHECK(during.allocations - before.allocations == 2);
+            CHECK(during.allocated_bytes - before.allocated_bytes == 6 + 4);
+        }
+        const auto after = snapshot();
+
+        CHECK(after.frees - before.frees == 2);
+        CHECK(after.freed_bytes - before.freed_bytes == after.allocated_bytes - before.allocated_bytes);
+    }
+
+    GIVEN("comparisons") {
+        weak_immutable_string abc{ "abc" };
+        weak_immutable_string abd{ "abd" };
+        weak_immutable_string_impl same{ abc };
+
+        const auto before = snapshot();
+        CHECK(string_compare_pendatic::eq(abc, same));
+        CHECK(!string_compare_pendatic::eq(abc, abd));
+        CHECK(string_compare_pendatic::lt(abc, abd));
+        CHECK(string_compare_ascii_icase::lt(abc, abd));
+        CHECK(!string_compare_safe::gt(abc, abd));
+        const auto after = snapshot();
+
+        const auto pendatic = static_cast<std::size_t>(policy::pendatic);
+        const auto icase = static_cast<std::size_t>(policy::ascii_icase);
+        const auto safe = static_cast<std::size_t>(policy::safe);
+        const auto eq = static_cast<std::size_t>(operation::eq);
+        const auto lt = static_cast<std::size_t>(operation::lt);
+        const auto gt = static_cast<std::size_t>(operation::gt);
+
+        CHECK(after.fast_path[pendatic][eq] - before.fast_path[pendatic][eq] == 1);
+        CHECK(after.full_compare[pendatic][eq] - before.full_compare[pendatic][eq] == 1);
+        CHECK(after.full_compare[pendatic][lt] - before.full_compare[pendatic][lt] == 1);
+        CHECK(after.full_compare[icase][lt] - before.full_compare[icase][lt] == 1);
+        CHECK(after.full_compare[safe][gt] - before.full_compare[safe][gt] == 1);
+        CHECK(after.compare_lengths[pendatic][histogram_bucket(3)] - before.compare_lengths[pendatic][histogram_bucket(3)] == 3);
+        CHECK(after.allocations - before.allocations == 0);
+    }
+}
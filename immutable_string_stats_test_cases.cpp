@@ -0,0 +1,55 @@
+#include "test.h"
+#include "immutable_string_stats.h"
+
+#include <thread>
+
+using namespace immutable_string_stats;
+
+TEST_CASE("stats histogram buckets") {
+    CHECK(histogram_bucket(0) == 0);
+    CHECK(histogram_bucket(1) == 1);
+    CHECK(histogram_bucket(2) == 2);
+    CHECK(histogram_bucket(3) == 2);
+    CHECK(histogram_bucket(4) == 3);
+    CHECK(histogram_bucket(65535) == 16);
+}
+
+TEST_CASE("stats aggregation") {
+    const auto before = snapshot();
+
+    record_allocation(10);
+    record_allocation(0);
+    record_free(10);
+    record_dup();
+    record_compare(policy::pendatic, operation::eq, true, 5);
+    record_compare(policy::pendatic, operation::eq, false, 5);
+    record_compare(policy::loose, operation::lt, false, 100);
+
+    std::thread worker{ [] {
+        record_allocation(3);
+        record_compare(policy::pendatic, operation::eq, false, 5);
+    } };
+    worker.join();
+
+    const auto after = snapshot();
+
+    CHECK(after.allocations - before.allocations == 3);
+    CHECK(after.allocated_bytes - before.allocated_bytes == 11 + 1 + 4);
+    CHECK(after.frees - before.frees == 1);
+    CHECK(after.freed_bytes - before.freed_bytes == 11);
+    CHECK(after.dups - before.dups == 1);
+    CHECK(after.allocation_lengths[0] - before.allocation_lengths[0] == 1);
+    CHECK(after.allocation_lengths[2] - before.allocation_lengths[2] == 1);
+    CHECK(after.allocation_lengths[4] - before.allocation_lengths[4] == 1);
+
+    const auto pendatic = static_cast<std::size_t>(policy::pendatic);
+    const auto loose = static_cast<std::size_t>(policy::loose);
+    const auto eq = static_cast<std::size_t>(operation::eq);
+    const auto lt = static_cast<std::size_t>(operation::lt);
+
+    CHECK(after.fast_path[pendatic][eq] - before.fast_path[pendatic][eq] == 1);
+    CHECK(after.full_compare[pendatic][eq] - before.full_compare[pendatic][eq] == 2);
+    CHECK(after.full_compare[loose][lt] - before.full_compare[loose][lt] == 1);
+    CHECK(after.compare_lengths[pendatic][3] - before.compare_lengths[pendatic][3] == 3);
+    CHECK(after.compare_lengths[loose][7] - before.compare_lengths[loose][7] == 1);
+}
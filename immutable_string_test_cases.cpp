@@ -2,4 +2,131 @@
 #include "immutable_string.h"
 #include "comparators.h"
 
-weak_immutable_string_impl str{ "" };
\ No newline at end of file
+weak_immutable_string_impl str{ "" };
+
+TEST_CASE("immutable string construction") {
+    GIVEN("owning strings") {
+        weak_immutable_string s{ "foo" };
+        strong_immutable_string t{ std::string{ "bar" } };
+        weak_immutable_string e;
+
+        CHECK(s.size() == 3);
+        CHECK(std::strcmp(s.c_str(), "foo") == 0);
+        CHECK(std::strcmp(t.c_str(), "bar") == 0);
+        CHECK(e.empty());
+        CHECK(std::strcmp(e.c_str(), "") == 0);
+
+        auto w = t.dup<false>();
+        CHECK(w.c_str() != t.c_str());
+        CHECK(string_compare_pendatic::eq(w, t));
+
+#if __cplusplus >= 201703L
+        auto d = t.dup<true>();
+        CHECK(d.c_str() != t.c_str());
+        CHECK(string_compare_pendatic::eq(d, t));
+#endif
+    }
+
+    GIVEN("a move") {
+        weak_immutable_string s{ "foo" };
+        weak_immutable_string m{ std::move(s) };
+
+        CHECK(s.empty());
+        CHECK(std::strcmp(s.c_str(), "") == 0);
+        CHECK(m.size() == 3);
+    }
+
+    GIVEN("a release") {
+        weak_immutable_string s{ "foo" };
+        auto uptr = s.release();
+        CHECK(std::strcmp(uptr.get(), "foo") == 0);
+        CHECK(s.empty());
+        CHECK(s.release() == nullptr);
+    }
+
+    GIVEN("a released buffer taken back") {
+        std::unique_ptr<char[]> uptr{ new char[4] };
+        std::strcpy(uptr.get(), "foo");
+        weak_immutable_string r{ std::move(uptr) };
+        CHECK(r.size() == 3);
+        CHECK(uptr == nullptr);
+    }
+
+    GIVEN("a strong string moved from a weak one") {
+        weak_immutable_string w{ "foo" };
+        auto data = w.data();
+        strong_immutable_string s{ std::move(w) };
+
+        CHECK(s.data() == data);
+        CHECK(s.size() == 3);
+        CHECK(w.empty());
+        CHECK(std::strcmp(w.c_str(), "") == 0);
+    }
+
+    GIVEN("views") {
+        weak_immutable_string s{ "foo" };
+        strong_immutable_string t{ "foo" };
+        weak_immutable_string_impl v{ s };
+        weak_immutable_string_impl w{ t };
+
+        CHECK(v.data() == s.data());
+        CHECK(w.data() == t.data());
+    }
+}
+
+TEST_CASE("comparators") {
+    weak_immutable_string_impl abc{ "abc" };
+    weak_immutable_string_impl abd{ "abd" };
+    strong_immutable_string abc_copy{ "abc" };
+    weak_immutable_string_impl ab{ "ab" };
+
+    CHECK(string_compare_pendatic::eq(abc, abc_copy));
+    CHECK(!string_compare_pendatic::eq(abc, abd));
+    CHECK(string_compare_pendatic::lt(ab, abc));
+    CHECK(string_compare_pendatic::lt(abc, abd));
+    CHECK(string_compare_safe::eq(abc, abc_copy));
+    CHECK(!string_compare_safe::eq(abc, abd));
+    CHECK(string_compare_safe::gt(abd, abc));
+    CHECK(string_compare_loose::lt(ab, abd));
+    CHECK(string_compare_weak::lt(abc, abd));
+
+    weak_immutable_string_view<string_compare_pendatic> x{ "abc" };
+    weak_immutable_string_view<string_compare_pendatic> y{ "abd" };
+    CHECK(x < y);
+    CHECK(x != y);
+    CHECK(!(x == y));
+    CHECK(y >= x);
+}
+
+TEST_CASE("ascii case insensitive comparator") {
+    using icase_view = weak_immutable_string_view<string_compare_ascii_icase>;
+
+    GIVEN("short strings") {
+        icase_view a{ "Content-Type" };
+        icase_view b{ "content-type" };
+        icase_view c{ "Content-Length" };
+
+        CHECK(a == b);
+        CHECK(c < a);
+        CHECK(a > c);
+        CHECK(string_compare_ascii_icase::lt(icase_view{ "ab" }, icase_view{ "AB1" }));
+        CHECK(!string_compare_ascii_icase::eq(icase_view{ "[" }, icase_view{ "{" }));
+        CHECK(string_hash_ascii_icase{}(a) == string_hash_ascii_icase{}(b));
+    }
+
+    GIVEN("long strings with a late difference") {
+        std::string upper = "ACCEPT-ENCODING-WITH-A-LONG-SUFFIX-\xC4-Z", lower = "accept-encoding-with-a-long-suffix-\xC4-z";
+        icase_view u{ upper }, l{ lower };
+
+        CHECK(u == l);
+        CHECK(string_hash_ascii_icase{}(u) == string_hash_ascii_icase{}(l));
+
+        lower[lower.size() - 1] = 'y';
+        CHECK(string_compare_ascii_icase::gt(u, icase_view{ lower }));
+        CHECK(string_hash_ascii_icase{}(u) != string_hash_ascii_icase{}(icase_view{ lower }));
+
+        // Only ASCII letters fold.
+        lower[35] = '\xE4';
+        CHECK(!string_compare_ascii_icase::eq(u, icase_view{ lower }));
+    }
+}
\ No newline at end of file
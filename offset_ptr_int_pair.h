@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+// Offsets are measured from the address of the offset_ptr_int_pair itself.
+struct self_relative {};
+
+// Any other Base is a segment policy providing
+//     static const void* base() noexcept;
+// and offsets are measured from that address.
+
+namespace detail {
+
+    template <bool SelfRelative>
+    struct offset_ptr_int_pair_storage {
+        std::uint64_t raw;
+
+        constexpr offset_ptr_int_pair_storage(std::uint64_t raw)
+        :raw{ raw }
+        {}
+    };
+
+    template <>
+    struct offset_ptr_int_pair_storage<true> {
+        static constexpr std::uint64_t low_bits_mask = (std::uint64_t(1) << 48) - 1;
+        static constexpr std::uint64_t null_offset = 1;
+
+        std::uint64_t raw;
+
+        // The stored offset is only meaningful at this address, so copies
+        // shift it by the distance between source and destination.
+        static inline std::uint64_t rebase(std::uint64_t raw, const void* from, const void* to) noexcept {
+            if ((raw & low_bits_mask) == null_offset) return raw;
+            auto delta = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(from) - reinterpret_cast<std::uintptr_t>(to));
+            return (raw & ~low_bits_mask) | ((raw + delta) & low_bits_mask);
+        }
+
+        constexpr offset_ptr_int_pair_storage(std::uint64_t raw)
+        :raw{ raw }
+        {}
+
+        offset_ptr_int_pair_storage(const offset_ptr_int_pair_storage &other) noexcept
+        :raw{ rebase(other.raw, &other, this) }
+        {}
+
+        offset_ptr_int_pair_storage &operator=(const offset_ptr_int_pair_storage &other) noexcept {
+            raw = rebase(other.raw, &other, this);
+            return *this;
+        }
+    };
+
+}
+
+template <typename PtrType, typename IntType, typename Base = self_relative>
+class offset_ptr_int_pair {
+
+    //
+    // Constants
+    //
+
+public:
+
+    static constexpr int ptr_size_requirement = 8;
+    static constexpr int int_size_limit = 2;
+    static constexpr bool is_self_relative = std::is_same<Base, self_relative>::value;
+
+private:
+
+    static constexpr int high_bits_offset = 48;
+    static constexpr std::uint64_t low_bits_mask = (std::uint64_t(1) << high_bits_offset) - 1;
+    static constexpr std::uint64_t high_bits_mask = ~low_bits_mask;
+    static constexpr std::uint64_t bit_47_mask = std::uint64_t(1) << 47;
+
+    // Same convention as boost::interprocess::offset_ptr: an offset of 1 is
+    // never a useful target and stands for nullptr.
+    static constexpr std::uint64_t null_offset = 1;
+
+    static_assert(sizeof(void*) == ptr_size_requirement, "offset_ptr_int_pair is only supported on 64 bit machines");
+    static_assert(sizeof(IntType) <= int_size_limit, "The given IntType is larger than 2 bytes");
+
+    //
+    // Member variables
+    //
+
+    detail::offset_ptr_int_pair_storage<is_self_relative> m_buffer;
+
+    //
+    // Helper functions
+    //
+
+    template <bool SelfRelative = is_self_relative>
+    inline std::enable_if_t<SelfRelative, std::uintptr_t> base() const noexcept {
+        return reinterpret_cast<std::uintptr_t>(this);
+    }
+
+    template <bool SelfRelative = is_self_relative>
+    inline std::enable_if_t<!SelfRelative, std::uintptr_t> base() const noexcept {
+        return reinterpret_cast<std::uintptr_t>(Base::base());
+    }
+
+    static constexpr std::uint64_t encode_int(IntType i) {
+        return std::uint64_t(static_cast<std::uint16_t>(i)) << high_bits_offset;
+    }
+
+    static constexpr std::int64_t sign_extend(std::uint64_t offset) {
+        return static_cast<std::int64_t>((offset ^ bit_47_mask) - bit_47_mask);
+    }
+
+    inline std::uint64_t encode_ptr(PtrType* ptr) const noexcept {
+        if (ptr == nullptr) return null_offset;
+
+        auto offset = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ptr) - base());
+        ASSERT(sign_extend(offset & low_bits_mask) == static_cast<std::int64_t>(offset));
+        ASSERT((offset & low_bits_mask) != null_offset);
+        return offset & low_bits_mask;
+    }
+
+    // Absolute address in the low 48 bits and the integer above, which is
+    // what ptr_int_pair_48va stores; gives a location independent ordering.
+    inline std::uint64_t canonical() const noexcept {
+        if (is_self_relative) {
+            return (m_buffer.raw & high_bits_mask) | (reinterpret_cast<std::uintptr_t>(pointer()) & low_bits_mask);
+        }
+        return m_buffer.raw;
+    }
+
+public:
+
+    //
+    // Constructors
+    //
+
+    offset_ptr_int_pair() noexcept
+    :m_buffer{ null_offset }
+    {}
+
+    offset_ptr_int_pair(PtrType* ptr) noexcept
+    :m_buffer{ null_offset }
+    {
+        m_buffer.raw = encode_ptr(ptr);
+    }
+
+    offset_ptr_int_pair(PtrType* ptr, IntType i) noexcept
+    :m_buffer{ null_offset }
+    {
+        m_buffer.raw = encode_int(i) | encode_ptr(ptr);
+    }
+
+    //
+    // Accessors
+    //
+
+    inline PtrType* pointer() const noexcept {
+        auto offset = m_buffer.raw & low_bits_mask;
+        if (offset == null_offset) return nullptr;
+        return reinterpret_cast<PtrType*>(base() + static_cast<std::uintptr_t>(sign_extend(offset)));
+    }
+
+    inline IntType integer() const noexcept {
+        return static_cast<IntType>(static_cast<std::uint16_t>(m_buffer.raw >> high_bits_offset));
+    }
+
+    // Signed distance from the base, or from this when self relative.
+    inline std::int64_t offset() const noexcept {
+        return sign_extend(m_buffer.raw & low_bits_mask);
+    }
+
+    inline void pointer(PtrType* ptr) noexcept {
+        m_buffer.raw = (m_buffer.raw & high_bits_mask) | encode_ptr(ptr);
+    }
+
+    inline void integer(IntType i) noexcept {
+        m_buffer.raw = (m_buffer.raw & low_bits_mask) | encode_int(i);
+    }
+
+    // Modifiers
+
+    inline std::enable_if_t<!std::is_const<IntType>::value> clear() noexcept {
+        m_buffer.raw = null_offset;
+    }
+
+    inline std::enable_if_t<!std::is_const<IntType>::value> swap(offset_ptr_int_pair &other) noexcept {
+        offset_ptr_int_pair tmp{ other.pointer(), other.integer() };
+        other = *this;
+        *this = tmp;
+    }
+
+    //
+    // Comparators
+    //
+
+    inline bool operator==(const offset_ptr_int_pair &other) const noexcept {
+        return canonical() == other.canonical();
+    }
+
+    inline bool operator!=(const offset_ptr_int_pair &other) const noexcept {
+        return !operator==(other);
+    }
+
+    inline bool logical_lt(const offset_ptr_int_pair &other) const noexcept {
+        auto lhs_ptr = canonical() & low_bits_mask;
+        auto rhs_ptr = other.canonical() & low_bits_mask;
+        return lhs_ptr < rhs_ptr ||
+               (lhs_ptr == rhs_ptr && integer() < other.integer());
+    }
+
+    inline bool opaque_lt(const offset_ptr_int_pair &other) const noexcept {
+        return canonical() < other.canonical();
+    }
+
+    struct logical_comparator {
+        inline bool operator()(const offset_ptr_int_pair &lhs, const offset_ptr_int_pair &rhs) const noexcept {
+            return lhs.logical_lt(rhs);
+        }
+    };
+
+    struct opaque_comparator {
+        inline bool operator()(const offset_ptr_int_pair &lhs, const offset_ptr_int_pair &rhs) const noexcept {
+            return lhs.opaque_lt(rhs);
+        }
+    };
+};
+
+namespace use_offset_ptr_int_pair_logical_lt {
+    template <typename PtrType, typename IntType, typename Base>
+    inline bool operator<(const offset_ptr_int_pair<PtrType, IntType, Base> &lhs, const offset_ptr_int_pair<PtrType, IntType, Base> &rhs) {
+        return lhs.logical_lt(rhs);
+    }
+}
+
+namespace use_offset_ptr_int_pair_opaque_lt {
+    template <typename PtrType, typename IntType, typename Base>
+    inline bool operator<(const offset_ptr_int_pair<PtrType, IntType, Base> &lhs, const offset_ptr_int_pair<PtrType, IntType, Base> &rhs) {
+        return lhs.opaque_lt(rhs);
+    }
+}
+
+template <typename PtrType, typename IntType, typename Base>
+inline void swap(offset_ptr_int_pair<PtrType, IntType, Base> &lhs, offset_ptr_int_pair<PtrType, IntType, Base> &rhs) noexcept {
+    lhs.swap(rhs);
+}
@@ -0,0 +1,133 @@
+#include "test.h"
+#include "offset_ptr_int_pair.h"
+
+#include <cstring>
+#include <set>
+#include <string>
+
+namespace {
+
+    struct node {
+        int value;
+        offset_ptr_int_pair<node, short> next;
+    };
+
+    struct test_segment {
+        static char* storage;
+
+        static const void* base() noexcept {
+            return storage;
+        }
+    };
+
+    char* test_segment::storage = nullptr;
+
+}
+
+TEST_CASE("self relative offset pointer") {
+    GIVEN("default constructed") {
+        offset_ptr_int_pair<int, short> p;
+
+        CHECK(p.pointer() == nullptr);
+        CHECK(p.integer() == 0);
+    }
+
+    GIVEN("constructed with pointer and int") {
+        int x = 1;
+        offset_ptr_int_pair<int, short> p{ &x, -3 };
+
+        CHECK(p.pointer() == &x);
+        CHECK(p.integer() == -3);
+
+        p.integer(7);
+        CHECK(p.pointer() == &x);
+        CHECK(p.integer() == 7);
+
+        p.pointer(nullptr);
+        CHECK(p.pointer() == nullptr);
+        CHECK(p.integer() == 7);
+
+        p.clear();
+        CHECK(p.pointer() == nullptr);
+        CHECK(p.integer() == 0);
+    }
+
+    GIVEN("copies") {
+        std::string str = "foo";
+        offset_ptr_int_pair<std::string, bool> p{ &str, true };
+        offset_ptr_int_pair<std::string, bool> q{ p };
+        offset_ptr_int_pair<std::string, bool> r;
+        r = q;
+
+        CHECK(q.pointer() == &str);
+        CHECK(r.pointer() == &str);
+        CHECK(r.integer() == true);
+        CHECK(p == q);
+        CHECK(q == r);
+        CHECK(p.offset() != q.offset());
+
+        offset_ptr_int_pair<std::string, bool> n;
+        swap(n, r);
+        CHECK(n.pointer() == &str);
+        CHECK(r.pointer() == nullptr);
+    }
+
+    GIVEN("a relocated buffer") {
+        node nodes[3];
+        nodes[0] = node{ 0, { &nodes[1], 1 } };
+        nodes[1] = node{ 1, { &nodes[2], 2 } };
+        nodes[2] = node{ 2, { nullptr, 3 } };
+
+        node moved[3];
+        std::memcpy(static_cast<void*>(moved), nodes, sizeof(nodes));
+
+        CHECK(moved[0].next.pointer() == &moved[1]);
+        CHECK(moved[1].next.pointer() == &moved[2]);
+        CHECK(moved[2].next.pointer() == nullptr);
+        CHECK(moved[1].next.integer() == 2);
+        CHECK(moved[0].next.pointer()->next.pointer()->value == 2);
+    }
+
+    GIVEN("ordering") {
+        int x[2] = {};
+        offset_ptr_int_pair<int, short> a{ &x[0], 5 };
+        offset_ptr_int_pair<int, short> b{ &x[1], 1 };
+        offset_ptr_int_pair<int, short> c{ &x[0], 6 };
+
+        CHECK(a.logical_lt(b));
+        CHECK(a.logical_lt(c));
+        CHECK(!b.logical_lt(a));
+        CHECK(b.opaque_lt(a));
+        CHECK(a.opaque_lt(c));
+
+        std::set<offset_ptr_int_pair<int, short>, offset_ptr_int_pair<int, short>::logical_comparator> s{ c, b, a };
+        auto it = s.begin();
+        CHECK(*it++ == a);
+        CHECK(*it++ == c);
+        CHECK(*it++ == b);
+    }
+}
+
+TEST_CASE("segment relative offset pointer") {
+    char segment[64] = {};
+    test_segment::storage = segment;
+
+    using pair_type = offset_ptr_int_pair<char, std::uint16_t, test_segment>;
+    static_assert(std::is_trivially_copyable<pair_type>::value, "Segment relative pairs should be trivially copyable");
+
+    pair_type p{ segment + 8, 42 };
+    CHECK(p.offset() == 8);
+    CHECK(p.pointer() == segment + 8);
+    CHECK(p.integer() == 42);
+
+    pair_type q;
+    std::memcpy(static_cast<void*>(&q), &p, sizeof(p));
+    CHECK(q == p);
+
+    char relocated[64] = {};
+    test_segment::storage = relocated;
+    CHECK(p.pointer() == relocated + 8);
+    CHECK(pair_type{}.pointer() == nullptr);
+
+    test_segment::storage = nullptr;
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+// Stores pointers as 6 byte little endian records. Only the low 48 bits of a
+// canonical address carry information; bits 48-63 are recovered by sign
+// extending bit 47, as ptr_int_pair_48va::pointer() does.
+template <typename T>
+class packed_ptr_vector {
+
+    //
+    // Constants
+    //
+
+public:
+
+    static constexpr int ptr_size_requirement = 8;
+    static constexpr std::size_t record_size = 6;
+
+private:
+
+    // Trailing bytes so that every record can be read with one 8 byte load.
+    static constexpr std::size_t padding = ptr_size_requirement - record_size;
+    static constexpr std::uint64_t low_bits_mask = (std::uint64_t(1) << 48) - 1;
+    static constexpr std::uint64_t bit_47_mask = std::uint64_t(1) << 47;
+
+    static_assert(sizeof(void*) == ptr_size_requirement, "packed_ptr_vector is only supported on 64 bit machines");
+
+public:
+
+    using value_type = T*;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+
+    class const_iterator {
+
+        const packed_ptr_vector* m_vec = nullptr;
+        size_type m_pos = 0;
+
+        friend class packed_ptr_vector;
+
+        constexpr const_iterator(const packed_ptr_vector* vec, size_type pos)
+        :m_vec{ vec }, m_pos{ pos }
+        {}
+
+    public:
+
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = T*;
+
+        constexpr const_iterator() = default;
+
+        inline reference operator*() const { return (*m_vec)[m_pos]; }
+        inline reference operator[](difference_type n) const { return (*m_vec)[m_pos + n]; }
+
+        inline const_iterator &operator++() { ++m_pos; return *this; }
+        inline const_iterator &operator--() { --m_pos; return *this; }
+        inline const_iterator operator++(int) { auto tmp = *this; ++m_pos; return tmp; }
+        inline const_iterator operator--(int) { auto tmp = *this; --m_pos; return tmp; }
+        inline const_iterator &operator+=(difference_type n) { m_pos += n; return *this; }
+        inline const_iterator &operator-=(difference_type n) { m_pos -= n; return *this; }
+
+        friend inline const_iterator operator+(const_iterator it, difference_type n) { return it += n; }
+        friend inline const_iterator operator+(difference_type n, const_iterator it) { return it += n; }
+        friend inline const_iterator operator-(const_iterator it, difference_type n) { return it -= n; }
+        friend inline difference_type operator-(const const_iterator &lhs, const const_iterator &rhs) {
+            return difference_type(lhs.m_pos) - difference_type(rhs.m_pos);
+        }
+
+        friend inline bool operator==(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos == rhs.m_pos; }
+        friend inline bool operator!=(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos != rhs.m_pos; }
+        friend inline bool operator<(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos < rhs.m_pos; }
+        friend inline bool operator>(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos > rhs.m_pos; }
+        friend inline bool operator<=(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos <= rhs.m_pos; }
+        friend inline bool operator>=(const const_iterator &lhs, const const_iterator &rhs) { return lhs.m_pos >= rhs.m_pos; }
+    };
+
+    using iterator = const_iterator;
+
+private:
+
+    //
+    // Member variables
+    //
+
+    // m_size records followed by the padding, or nothing at all once the
+    // vector has been moved from.
+    std::vector<unsigned char> m_bytes = std::vector<unsigned char>(padding);
+    size_type m_size = 0;
+
+    //
+    // Helper functions
+    //
+
+    static inline bool is_canonical(std::uint64_t raw) noexcept {
+        return (((raw & low_bits_mask) ^ bit_47_mask) - bit_47_mask) == raw;
+    }
+
+    static inline T* decode(const unsigned char* src) noexcept {
+        std::uint64_t raw;
+        std::memcpy(&raw, src, sizeof(raw));
+        raw &= low_bits_mask;
+        return reinterpret_cast<T*>((raw ^ bit_47_mask) - bit_47_mask);
+    }
+
+    static inline void encode(unsigned char* dst, T* ptr) noexcept {
+        auto raw = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(ptr));
+        ASSERT(is_canonical(raw));
+        std::memcpy(dst, &raw, record_size);
+    }
+
+    inline const unsigned char* record(size_type pos) const noexcept {
+        return m_bytes.data() + pos * record_size;
+    }
+
+    inline unsigned char* record(size_type pos) noexcept {
+        return m_bytes.data() + pos * record_size;
+    }
+
+public:
+
+    //
+    // Constructors
+    //
+
+    packed_ptr_vector() = default;
+
+    template <typename InputIt>
+    packed_ptr_vector(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            push_back(*first);
+        }
+    }
+
+    packed_ptr_vector(std::initializer_list<T*> list)
+    :packed_ptr_vector(list.begin(), list.end())
+    {}
+
+    packed_ptr_vector(const packed_ptr_vector&) = default;
+    packed_ptr_vector &operator=(const packed_ptr_vector&) = default;
+
+    packed_ptr_vector(packed_ptr_vector &&other) noexcept
+    :m_bytes{ std::move(other.m_bytes) }, m_size{ other.m_size }
+    {
+        other.m_bytes.clear();
+        other.m_size = 0;
+    }
+
+    packed_ptr_vector &operator=(packed_ptr_vector &&other) noexcept {
+        if (this != &other) {
+            m_bytes = std::move(other.m_bytes);
+            m_size = other.m_size;
+            other.m_bytes.clear();
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    //
+    // Accessors
+    //
+
+    inline T* operator[](size_type pos) const noexcept {
+        return decode(record(pos));
+    }
+
+    inline T* at(size_type pos) const {
+        ASSERT(pos < size());
+        return operator[](pos);
+    }
+
+    inline T* front() const noexcept {
+        return operator[](0);
+    }
+
+    inline T* back() const noexcept {
+        return operator[](size() - 1);
+    }
+
+    inline const_iterator begin() const noexcept {
+        return const_iterator{ this, 0 };
+    }
+
+    inline const_iterator cbegin() const noexcept {
+        return begin();
+    }
+
+    inline const_iterator end() const noexcept {
+        return const_iterator{ this, size() };
+    }
+
+    inline const_iterator cend() const noexcept {
+        return end();
+    }
+
+    inline size_type size() const noexcept {
+        return m_size;
+    }
+
+    inline bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    inline size_type capacity() const noexcept {
+        auto bytes = m_bytes.capacity();
+        return bytes > padding ? (bytes - padding) / record_size : 0;
+    }
+
+    // Size of the encoded records in bytes, excluding the trailing padding.
+    inline size_type size_in_bytes() const noexcept {
+        return m_size * record_size;
+    }
+
+    // Decodes count pointers starting at pos into out.
+    void decode_n(size_type pos, size_type count, T** out) const noexcept {
+        ASSERT(pos + count <= size());
+        size_type i = 0;
+
+#if defined(__AVX2__)
+        // Each 128 bit lane holds two records; the lane loads overlap by four
+        // bytes, which the padding and the pos + i + 5 bound keep in range.
+        const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1,
+                                                 0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+        const __m256i bit_47 = _mm256_set1_epi64x(static_cast<long long>(bit_47_mask));
+        const size_type n = size();
+
+        for (; i + 4 <= count && pos + i + 5 <= n; i += 4) {
+            const unsigned char* src = record(pos + i);
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * record_size));
+            __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            v = _mm256_shuffle_epi8(v, shuffle);
+            v = _mm256_sub_epi64(_mm256_xor_si256(v, bit_47), bit_47);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+        }
+#endif
+
+        for (; i < count; ++i) {
+            out[i] = decode(record(pos + i));
+        }
+    }
+
+    inline void decode_all(T** out) const noexcept {
+        decode_n(0, size(), out);
+    }
+
+    //
+    // Modifiers
+    //
+
+    inline void reserve(size_type n) {
+        m_bytes.reserve(n * record_size + padding);
+    }
+
+    inline void shrink_to_fit() {
+        m_bytes.shrink_to_fit();
+    }
+
+    inline void push_back(T* ptr) {
+        m_bytes.resize((m_size + 1) * record_size + padding);
+        encode(record(m_size), ptr);
+        ++m_size;
+    }
+
+    inline void pop_back() noexcept {
+        ASSERT(!empty());
+        --m_size;
+        m_bytes.resize(m_size * record_size + padding);
+    }
+
+    inline void set(size_type pos, T* ptr) noexcept {
+        ASSERT(pos < size());
+        encode(record(pos), ptr);
+    }
+
+    inline void resize(size_type n) {
+        m_bytes.resize(n * record_size + padding);
+        m_size = n;
+    }
+
+    inline void clear() noexcept {
+        if (!m_bytes.empty()) m_bytes.resize(padding);
+        m_size = 0;
+    }
+
+    inline void swap(packed_ptr_vector &other) noexcept {
+        m_bytes.swap(other.m_bytes);
+        std::swap(m_size, other.m_size);
+    }
+};
+
+template <typename T>
+inline void swap(packed_ptr_vector<T> &lhs, packed_ptr_vector<T> &rhs) noexcept {
+    lhs.swap(rhs);
+}
@@ -0,0 +1,118 @@
+#include "test.h"
+#include "packed_ptr_vector.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+TEST_CASE("packed pointer vector") {
+    GIVEN("an empty vector") {
+        packed_ptr_vector<int> v;
+
+        CHECK(v.empty());
+        CHECK(v.size() == 0);
+        CHECK(v.size_in_bytes() == 0);
+        CHECK(v.begin() == v.end());
+    }
+
+    GIVEN("push back and access") {
+        std::vector<int> values(10);
+        packed_ptr_vector<int> v;
+
+        for (auto &x : values) {
+            v.push_back(&x);
+        }
+        v.push_back(nullptr);
+
+        REQUIRE(v.size() == 11);
+        CHECK(v.size_in_bytes() == 11 * 6);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            CHECK(v[i] == &values[i]);
+        }
+        CHECK(v.front() == &values.front());
+        CHECK(v.back() == nullptr);
+
+        v.set(10, &values[3]);
+        CHECK(v.back() == &values[3]);
+
+        v.pop_back();
+        CHECK(v.size() == 10);
+        CHECK(v.back() == &values.back());
+
+        SECTION("iteration") {
+            CHECK(std::equal(v.begin(), v.end(), values.begin(), values.end(),
+                             [](int* p, int &x) { return p == &x; }));
+            CHECK(v.end() - v.begin() == 10);
+            CHECK(*(v.begin() + 4) == &values[4]);
+            CHECK(v.begin()[9] == &values[9]);
+        }
+
+        SECTION("clear") {
+            v.clear();
+            CHECK(v.empty());
+            v.push_back(&values[1]);
+            CHECK(v[0] == &values[1]);
+        }
+
+        SECTION("moved from") {
+            auto moved = std::move(v);
+            CHECK(moved.size() == 10);
+            CHECK(moved.back() == &values.back());
+            CHECK(v.empty());
+            CHECK(v.size_in_bytes() == 0);
+            CHECK(v.capacity() == 0);
+            CHECK(v.begin() == v.end());
+
+            v.push_back(&values[2]);
+            v.push_back(&values[5]);
+            CHECK(v.size() == 2);
+            CHECK(v.back() == &values[5]);
+
+            int* out[2] = {};
+            v.decode_all(out);
+            CHECK(out[0] == &values[2]);
+
+            packed_ptr_vector<int> assigned;
+            assigned = std::move(v);
+            CHECK(assigned.size() == 2);
+            CHECK(v.empty());
+            v.clear();
+            CHECK(v.empty());
+            v.resize(3);
+            CHECK(v.size() == 3);
+        }
+    }
+
+    GIVEN("pointer bit extension") {
+        char* high = reinterpret_cast<char*>(~std::uintptr_t{ 0 } - 15);
+        char* low = reinterpret_cast<char*>(std::uintptr_t{ 0x00007fffffffffff });
+        packed_ptr_vector<char> v{ high, low, nullptr };
+
+        CHECK(v[0] == high);
+        CHECK(v[1] == low);
+        CHECK(v[2] == nullptr);
+    }
+
+    GIVEN("bulk decode") {
+        std::vector<long> values(37);
+        std::vector<long*> expected;
+        for (auto &x : values) {
+            expected.push_back(&x);
+        }
+        expected.push_back(reinterpret_cast<long*>(~std::uintptr_t{ 0 } - 7));
+
+        packed_ptr_vector<long> v(expected.begin(), expected.end());
+
+        for (std::size_t pos : { 0, 1, 5, 33 }) {
+            for (std::size_t count = 0; pos + count <= v.size(); count += 3) {
+                std::vector<long*> out(count);
+                v.decode_n(pos, count, out.data());
+                CHECK(std::equal(out.begin(), out.end(), expected.begin() + pos));
+            }
+        }
+
+        std::vector<long*> all(v.size());
+        v.decode_all(all.data());
+        CHECK(all == expected);
+    }
+}
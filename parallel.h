@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Fork/join helpers shared by the bulk kernels.
+
+namespace detail {
+
+    // Number of threads to split n elements over. threads == 0 asks for every
+    // hardware thread; no thread gets fewer than min_chunk elements.
+    inline std::size_t worker_count(std::size_t threads, std::size_t n, std::size_t min_chunk) noexcept {
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        return std::max<std::size_t>(1, std::min(threads, n / min_chunk));
+    }
+
+    // Runs fn(t) for t in [0, threads), the first on the calling thread.
+    template <typename F>
+    void run_on_threads(std::size_t threads, F &&fn) {
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        try {
+            for (std::size_t t = 1; t < threads; ++t) {
+                workers.emplace_back(fn, t);
+            }
+        }
+        catch (...) {
+            for (auto &w : workers) w.join();
+            throw;
+        }
+        fn(0);
+        for (auto &w : workers) w.join();
+    }
+
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "immutable_string.h"
+#include "comparators.h"
+
+// Perfect hash tables over string literal keys, built entirely during
+// constant evaluation (PTHash style hash-and-displace). Keys are split into
+// buckets by one part of the hash, and every bucket gets the smallest pilot
+// that sends all of its keys to free slots. Lookups hash once, read one
+// pilot and verify one slot with string_compare_pendatic.
+
+namespace detail {
+
+    constexpr std::uint64_t phf_mix(std::uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // Assembles the word byte by byte, which constant evaluation allows
+    // where word_load's memcpy is not.
+    struct phf_constexpr_load {
+        constexpr std::uint64_t operator()(const char* str, std::size_t len) const noexcept {
+            std::uint64_t chunk = 0;
+            for (std::size_t i = 0; i < len; ++i) {
+                chunk |= std::uint64_t(static_cast<unsigned char>(str[i])) << (8 * i);
+            }
+            return chunk;
+        }
+    };
+
+    // Both overloads produce the same value; the runtime one reads whole
+    // words and the constexpr one assembles them byte by byte.
+    constexpr std::uint64_t phf_hash(constexpr_op_t, const char* str, std::size_t len, std::uint64_t seed) {
+        return phf_mix(word_hash(str, len, seed, phf_constexpr_load{}));
+    }
+
+    inline std::uint64_t phf_hash(const char* str, std::size_t len, std::uint64_t seed) noexcept {
+        return phf_mix(word_hash(str, len, seed));
+    }
+
+    constexpr std::size_t phf_table_size(std::size_t n) {
+        std::size_t size = 1;
+        while (size < n) size <<= 1;
+        return size;
+    }
+
+    template <std::size_t N>
+    class perfect_hash_table {
+
+    public:
+
+        using size_type = std::uint16_t;
+
+        static constexpr std::size_t key_count = N;
+        static constexpr std::size_t table_size = phf_table_size(N);
+        static constexpr std::size_t bucket_count = (N + 3) / 4 > 0 ? (N + 3) / 4 : 1;
+        static constexpr std::uint32_t max_pilot = 1u << 16;
+        static constexpr std::uint64_t max_seed = 64;
+
+        static_assert(N > 0, "Perfect hash tables need at least one key");
+
+    protected:
+
+        std::uint64_t m_seed = 0;
+        std::uint32_t m_pilots[bucket_count] = {};
+        const char* m_keys[table_size] = {};
+        size_type m_lengths[table_size] = {};
+
+        static constexpr std::size_t bucket_of(std::uint64_t h) {
+            return static_cast<std::size_t>((h >> 32) % bucket_count);
+        }
+
+        static constexpr std::size_t slot_of(std::uint64_t h, std::uint32_t pilot) {
+            return static_cast<std::size_t>(phf_mix(h + (std::uint64_t(pilot) + 1) * 0x9e3779b97f4a7c15ULL) & (table_size - 1));
+        }
+
+        static constexpr bool same_key(const char* lhs, std::size_t lhs_len, const char* rhs, std::size_t rhs_len) {
+            if (lhs_len != rhs_len) return false;
+            for (std::size_t i = 0; i < lhs_len; ++i) {
+                if (lhs[i] != rhs[i]) return false;
+            }
+            return true;
+        }
+
+        constexpr bool try_build(const char* const* keys, const std::size_t* lengths) {
+            std::uint64_t hashes[N] = {};
+            std::size_t bucket_sizes[bucket_count] = {};
+            std::size_t bucket_begin[bucket_count + 1] = {};
+            std::size_t members[N] = {};
+            std::size_t fill[bucket_count] = {};
+            bool taken[table_size] = {};
+
+            for (std::size_t i = 0; i < N; ++i) {
+                hashes[i] = phf_hash(constexpr_op, keys[i], lengths[i], m_seed);
+                ++bucket_sizes[bucket_of(hashes[i])];
+            }
+
+            for (std::size_t b = 0; b < bucket_count; ++b) {
+                bucket_begin[b + 1] = bucket_begin[b] + bucket_sizes[b];
+            }
+            for (std::size_t i = 0; i < N; ++i) {
+                auto b = bucket_of(hashes[i]);
+                members[bucket_begin[b] + fill[b]++] = i;
+            }
+
+            // Largest buckets first, while the table is still mostly empty.
+            for (std::size_t size = N; size > 0; --size) {
+                for (std::size_t b = 0; b < bucket_count; ++b) {
+                    if (bucket_sizes[b] != size) continue;
+
+                    bool placed = false;
+                    for (std::uint32_t pilot = 0; pilot < max_pilot && !placed; ++pilot) {
+                        placed = true;
+                        for (std::size_t j = bucket_begin[b]; j < bucket_begin[b + 1] && placed; ++j) {
+                            auto pos = slot_of(hashes[members[j]], pilot);
+                            if (taken[pos]) placed = false;
+                            for (std::size_t k = bucket_begin[b]; k < j && placed; ++k) {
+                                if (slot_of(hashes[members[k]], pilot) == pos) placed = false;
+                            }
+                        }
+
+                        if (placed) {
+                            m_pilots[b] = pilot;
+                            for (std::size_t j = bucket_begin[b]; j < bucket_begin[b + 1]; ++j) {
+                                auto pos = slot_of(hashes[members[j]], pilot);
+                                taken[pos] = true;
+                                m_keys[pos] = keys[members[j]];
+                                m_lengths[pos] = static_cast<size_type>(lengths[members[j]]);
+                            }
+                        }
+                    }
+
+                    if (!placed) return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr void build(const char* const* keys) {
+            std::size_t lengths[N] = {};
+            for (std::size_t i = 0; i < N; ++i) {
+                lengths[i] = ct_strlen(keys[i]);
+                if (lengths[i] > std::numeric_limits<size_type>::max()) throw std::out_of_range{ "Key too long" };
+                for (std::size_t j = 0; j < i; ++j) {
+                    if (same_key(keys[i], lengths[i], keys[j], lengths[j])) throw std::invalid_argument{ "Duplicate key" };
+                }
+            }
+
+            for (m_seed = 0; m_seed < max_seed; ++m_seed) {
+                for (auto &key : m_keys) key = nullptr;
+                if (try_build(keys, lengths)) return;
+            }
+            throw std::logic_error{ "Unable to build a perfect hash" };
+        }
+
+        template <typename Key>
+        inline std::size_t find_slot(const Key &key) const noexcept {
+            auto h = phf_hash(key.data(), key.size(), m_seed);
+            auto pos = slot_of(h, m_pilots[bucket_of(h)]);
+            if (m_keys[pos] == nullptr) return table_size;
+
+            return string_compare_pendatic::eq(key, strong_immutable_string_impl{ m_keys[pos], m_lengths[pos] }) ? pos : table_size;
+        }
+
+    public:
+
+        constexpr std::size_t size() const {
+            return N;
+        }
+
+        template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+        inline bool contains(const Key &key) const noexcept {
+            return find_slot(key) != table_size;
+        }
+    };
+
+}
+
+template <typename Value, std::size_t N>
+class perfect_hash_map : public detail::perfect_hash_table<N> {
+
+    using base_type = detail::perfect_hash_table<N>;
+
+    static_assert(std::is_default_constructible<Value>::value, "Value must be default constructible");
+
+    Value m_values[base_type::table_size] = {};
+
+public:
+
+    using value_type = Value;
+
+    constexpr perfect_hash_map(const std::pair<const char*, Value> (&entries)[N]) {
+        const char* keys[N] = {};
+        for (std::size_t i = 0; i < N; ++i) {
+            keys[i] = entries[i].first;
+        }
+        base_type::build(keys);
+
+        for (std::size_t i = 0; i < N; ++i) {
+            auto h = detail::phf_hash(constexpr_op, keys[i], ct_strlen(keys[i]), base_type::m_seed);
+            m_values[base_type::slot_of(h, base_type::m_pilots[base_type::bucket_of(h)])] = entries[i].second;
+        }
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline const Value* find(const Key &key) const noexcept {
+        auto pos = base_type::find_slot(key);
+        return pos != base_type::table_size ? &m_values[pos] : nullptr;
+    }
+};
+
+template <std::size_t N>
+class perfect_hash_set : public detail::perfect_hash_table<N> {
+
+public:
+
+    constexpr perfect_hash_set(const char* const (&keys)[N]) {
+        detail::perfect_hash_table<N>::build(keys);
+    }
+};
+
+template <typename Value, std::size_t N>
+constexpr perfect_hash_map<Value, N> make_perfect_hash_map(const std::pair<const char*, Value> (&entries)[N]) {
+    return perfect_hash_map<Value, N>{ entries };
+}
+
+template <std::size_t N>
+constexpr perfect_hash_set<N> make_perfect_hash_set(const char* const (&keys)[N]) {
+    return perfect_hash_set<N>{ keys };
+}
@@ -0,0 +1,85 @@
+#include "test.h"
+#include "perfect_hash_map.h"
+
+#include <string>
+
+namespace {
+
+    enum class keyword { none, if_, else_, while_, for_, return_, switch_, case_, default_, a_rather_long_keyword };
+
+    constexpr auto keywords = make_perfect_hash_map<keyword>({
+        { "if", keyword::if_ },
+        { "else", keyword::else_ },
+        { "while", keyword::while_ },
+        { "for", keyword::for_ },
+        { "return", keyword::return_ },
+        { "switch", keyword::switch_ },
+        { "case", keyword::case_ },
+        { "default", keyword::default_ },
+        { "a_rather_long_keyword", keyword::a_rather_long_keyword },
+    });
+
+    constexpr auto headers = make_perfect_hash_set({
+        "accept", "accept-encoding", "authorization", "cache-control", "connection",
+        "content-length", "content-type", "cookie", "host", "user-agent", "",
+    });
+
+}
+
+TEST_CASE("perfect hash map") {
+    static_assert(keywords.size() == 9, "");
+
+    GIVEN("every key") {
+        const std::pair<const char*, keyword> expected[] = {
+            { "if", keyword::if_ }, { "else", keyword::else_ }, { "while", keyword::while_ },
+            { "for", keyword::for_ }, { "return", keyword::return_ }, { "switch", keyword::switch_ },
+            { "case", keyword::case_ }, { "default", keyword::default_ },
+            { "a_rather_long_keyword", keyword::a_rather_long_keyword },
+        };
+
+        for (const auto &e : expected) {
+            weak_immutable_string_impl key{ e.first };
+            auto value = keywords.find(key);
+            REQUIRE(value != nullptr);
+            CHECK(*value == e.second);
+        }
+    }
+
+    GIVEN("keys that are not present") {
+        for (const char* str : { "", "i", "iff", "While", "a_rather_long_keywor", "a_rather_long_keyword_" }) {
+            weak_immutable_string_impl key{ str };
+            CHECK(keywords.find(key) == nullptr);
+        }
+    }
+
+    GIVEN("owning and non-literal keys") {
+        std::string str = "return";
+        strong_immutable_string owned{ str };
+        weak_immutable_string_impl view{ str };
+
+        REQUIRE(keywords.find(owned) != nullptr);
+        CHECK(*keywords.find(owned) == keyword::return_);
+        CHECK(*keywords.find(view) == keyword::return_);
+    }
+}
+
+TEST_CASE("perfect hash set") {
+    static_assert(headers.size() == 11, "");
+
+    for (const char* str : { "accept", "content-type", "user-agent", "" }) {
+        CHECK(headers.contains(weak_immutable_string_impl{ str }));
+    }
+
+    for (const char* str : { "accepts", "content", "Host", "x" }) {
+        CHECK(!headers.contains(weak_immutable_string_impl{ str }));
+    }
+}
+
+TEST_CASE("perfect hash function") {
+    const char* str = "some key that spans several words";
+    auto len = std::strlen(str);
+
+    for (std::size_t i = 0; i <= len; ++i) {
+        CHECK(detail::phf_hash(str, i, 7) == detail::phf_hash(constexpr_op, str, i, 7));
+    }
+}
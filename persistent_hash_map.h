@@ -0,0 +1,502 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "immutable_string.h"
+#include "comparators.h"
+#include "bit_utils.h"
+#include "ptr_int_pair_48va.h"
+
+// A persistent hash array mapped trie keyed by strong_immutable_string.
+// Nodes are never modified once built and are shared between every map that
+// can reach them, so copying a map only bumps the root's reference count and
+// an update copies the O(log32 n) nodes on the path to the changed leaf.
+// Copies can be handed to other threads and read without locking; node
+// reference counts are atomic so the last owner frees them from any thread.
+//
+// Every child link is a ptr_int_pair_48va whose tag holds the kind of the
+// node it points at in the low two bits and, above them, the number of
+// children of a branch or entries of a collision node.
+
+namespace detail {
+
+    enum class hamt_kind : std::uint16_t {
+        leaf = 0,
+        branch = 1,
+        collision = 2
+    };
+
+    struct hamt_node {
+        mutable std::atomic<std::uint32_t> refs{ 1 };
+    };
+
+    using hamt_link = ptr_int_pair_48va<const hamt_node, std::uint16_t>;
+
+    static constexpr int hamt_bits = 5;
+    static constexpr std::uint64_t hamt_mask = (1 << hamt_bits) - 1;
+    static constexpr std::uint16_t hamt_max_count = (1 << 14) - 1;
+
+    inline hamt_link make_hamt_link(const hamt_node* node, hamt_kind kind, std::size_t count = 0) noexcept {
+        auto saturated = count < hamt_max_count ? count : hamt_max_count;
+        return hamt_link{ node, static_cast<std::uint16_t>(static_cast<std::uint16_t>(kind) | (saturated << 2)) };
+    }
+
+    inline hamt_kind kind_of(hamt_link link) noexcept {
+        return static_cast<hamt_kind>(link.integer() & 3);
+    }
+
+    inline std::size_t count_of(hamt_link link) noexcept {
+        return link.integer() >> 2;
+    }
+
+    inline hamt_link retain(hamt_link link) noexcept {
+        if (link.pointer() != nullptr) {
+            link.pointer()->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return link;
+    }
+
+    template <typename Value>
+    class hamt {
+
+    public:
+
+        struct leaf : hamt_node {
+            std::uint64_t hash;
+            strong_immutable_string key;
+            Value value;
+
+            template <typename Key>
+            leaf(std::uint64_t h, const Key &k, Value &&v)
+            :hash{ h }, key{ k.data(), k.size() }, value(std::move(v))
+            {}
+
+            leaf(const leaf &other, Value &&v)
+            :hash{ other.hash }, key{ other.key.data(), other.key.size() }, value(std::move(v))
+            {}
+        };
+
+        // children[i] holds the i-th set bit of bitmap, lowest first.
+        struct branch : hamt_node {
+            std::uint32_t bitmap = 0;
+            std::vector<hamt_link> children;
+        };
+
+        // Leaves whose full 64 bit hashes are equal.
+        struct collision : hamt_node {
+            std::uint64_t hash;
+            std::vector<hamt_link> leaves;
+        };
+
+        static const leaf* as_leaf(hamt_link link) noexcept {
+            return static_cast<const leaf*>(link.pointer());
+        }
+
+        static const branch* as_branch(hamt_link link) noexcept {
+            return static_cast<const branch*>(link.pointer());
+        }
+
+        static const collision* as_collision(hamt_link link) noexcept {
+            return static_cast<const collision*>(link.pointer());
+        }
+
+        static hamt_link link_to(const leaf* node) noexcept {
+            return make_hamt_link(node, hamt_kind::leaf);
+        }
+
+        static hamt_link link_to(const branch* node) noexcept {
+            return make_hamt_link(node, hamt_kind::branch, node->children.size());
+        }
+
+        static hamt_link link_to(const collision* node) noexcept {
+            return make_hamt_link(node, hamt_kind::collision, node->leaves.size());
+        }
+
+        static void release(hamt_link link) noexcept {
+            auto node = link.pointer();
+            if (node == nullptr || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+            switch (kind_of(link)) {
+            case hamt_kind::leaf:
+                delete as_leaf(link);
+                break;
+            case hamt_kind::branch:
+                for (auto child : as_branch(link)->children) release(child);
+                delete as_branch(link);
+                break;
+            case hamt_kind::collision:
+                for (auto child : as_collision(link)->leaves) release(child);
+                delete as_collision(link);
+                break;
+            }
+        }
+
+        static std::uint64_t hash_of(hamt_link link) noexcept {
+            return kind_of(link) == hamt_kind::leaf ? as_leaf(link)->hash : as_collision(link)->hash;
+        }
+
+        template <typename Key>
+        static const Value* find(hamt_link node, std::uint64_t hash, const Key &key) noexcept {
+            for (int shift = 0; node.pointer() != nullptr; shift += hamt_bits) {
+                switch (kind_of(node)) {
+                case hamt_kind::leaf: {
+                    auto l = as_leaf(node);
+                    return l->hash == hash && string_compare_pendatic::eq(l->key, key) ? &l->value : nullptr;
+                }
+                case hamt_kind::collision: {
+                    auto c = as_collision(node);
+                    if (c->hash != hash) return nullptr;
+                    for (auto child : c->leaves) {
+                        if (string_compare_pendatic::eq(as_leaf(child)->key, key)) return &as_leaf(child)->value;
+                    }
+                    return nullptr;
+                }
+                case hamt_kind::branch: {
+                    auto b = as_branch(node);
+                    auto bit = std::uint32_t(1) << ((hash >> shift) & hamt_mask);
+                    if (!(b->bitmap & bit)) return nullptr;
+                    node = b->children[popcount32(b->bitmap & (bit - 1))];
+                    break;
+                }
+                }
+            }
+            return nullptr;
+        }
+
+        // Joins two leaf or collision nodes with different hashes under as
+        // many branches as it takes for their hash bits to differ. Takes
+        // ownership of both links.
+        static hamt_link join(hamt_link a, hamt_link b, int shift) {
+            auto ha = hash_of(a);
+            auto hb = hash_of(b);
+            auto node = new branch;
+            auto ia = (ha >> shift) & hamt_mask;
+            auto ib = (hb >> shift) & hamt_mask;
+            if (ia == ib) {
+                node->bitmap = std::uint32_t(1) << ia;
+                node->children.push_back(join(a, b, shift + hamt_bits));
+            }
+            else {
+                node->bitmap = (std::uint32_t(1) << ia) | (std::uint32_t(1) << ib);
+                node->children.push_back(ia < ib ? a : b);
+                node->children.push_back(ia < ib ? b : a);
+            }
+            return link_to(node);
+        }
+
+        // Returns a new node equal to node with key set to value. Nothing
+        // reachable from node changes; untouched children are shared.
+        template <typename Key>
+        static hamt_link insert(hamt_link node, int shift, std::uint64_t hash, const Key &key, Value &value, bool &added) {
+            if (node.pointer() == nullptr) {
+                added = true;
+                return link_to(new leaf{ hash, key, std::move(value) });
+            }
+
+            switch (kind_of(node)) {
+            case hamt_kind::leaf: {
+                auto l = as_leaf(node);
+                if (l->hash == hash && string_compare_pendatic::eq(l->key, key)) {
+                    added = false;
+                    return link_to(new leaf{ *l, std::move(value) });
+                }
+
+                added = true;
+                auto fresh = link_to(new leaf{ hash, key, std::move(value) });
+                if (l->hash != hash) {
+                    return join(retain(node), fresh, shift);
+                }
+
+                auto c = new collision;
+                c->hash = hash;
+                c->leaves.push_back(retain(node));
+                c->leaves.push_back(fresh);
+                return link_to(c);
+            }
+
+            case hamt_kind::collision: {
+                auto old = as_collision(node);
+                if (old->hash != hash) {
+                    added = true;
+                    return join(retain(node), link_to(new leaf{ hash, key, std::move(value) }), shift);
+                }
+
+                auto c = new collision;
+                c->hash = hash;
+                c->leaves.reserve(old->leaves.size() + 1);
+                added = true;
+                for (auto child : old->leaves) {
+                    if (added && string_compare_pendatic::eq(as_leaf(child)->key, key)) {
+                        added = false;
+                        c->leaves.push_back(link_to(new leaf{ *as_leaf(child), std::move(value) }));
+                    }
+                    else {
+                        c->leaves.push_back(retain(child));
+                    }
+                }
+                if (added) {
+                    c->leaves.push_back(link_to(new leaf{ hash, key, std::move(value) }));
+                }
+                return link_to(c);
+            }
+
+            case hamt_kind::branch: {
+                auto old = as_branch(node);
+                auto bit = std::uint32_t(1) << ((hash >> shift) & hamt_mask);
+                auto pos = popcount32(old->bitmap & (bit - 1));
+
+                auto b = new branch;
+                b->bitmap = old->bitmap | bit;
+                b->children.reserve(old->children.size() + 1);
+                for (std::size_t i = 0; i < pos; ++i) {
+                    b->children.push_back(retain(old->children[i]));
+                }
+                if (old->bitmap & bit) {
+                    b->children.push_back(insert(old->children[pos], shift + hamt_bits, hash, key, value, added));
+                    ++pos;
+                }
+                else {
+                    added = true;
+                    b->children.push_back(link_to(new leaf{ hash, key, std::move(value) }));
+                }
+                for (std::size_t i = pos; i < old->children.size(); ++i) {
+                    b->children.push_back(retain(old->children[i]));
+                }
+                return link_to(b);
+            }
+            }
+            return node;
+        }
+
+        // Returns a new node equal to node without key, which may be null,
+        // or node itself with an extra reference if key isn't there.
+        // Branches left with a single leaf or collision child collapse into
+        // it so the trie stays as shallow as the hashes allow.
+        template <typename Key>
+        static hamt_link erase(hamt_link node, int shift, std::uint64_t hash, const Key &key, bool &removed) {
+            removed = false;
+            if (node.pointer() == nullptr) return node;
+
+            switch (kind_of(node)) {
+            case hamt_kind::leaf: {
+                auto l = as_leaf(node);
+                if (l->hash == hash && string_compare_pendatic::eq(l->key, key)) {
+                    removed = true;
+                    return hamt_link{};
+                }
+                return retain(node);
+            }
+
+            case hamt_kind::collision: {
+                auto old = as_collision(node);
+                std::size_t found = old->leaves.size();
+                if (old->hash == hash) {
+                    for (std::size_t i = 0; i < old->leaves.size(); ++i) {
+                        if (string_compare_pendatic::eq(as_leaf(old->leaves[i])->key, key)) {
+                            found = i;
+                            break;
+                        }
+                    }
+                }
+                if (found == old->leaves.size()) return retain(node);
+
+                removed = true;
+                if (old->leaves.size() == 2) return retain(old->leaves[1 - found]);
+
+                auto c = new collision;
+                c->hash = hash;
+                c->leaves.reserve(old->leaves.size() - 1);
+                for (std::size_t i = 0; i < old->leaves.size(); ++i) {
+                    if (i != found) c->leaves.push_back(retain(old->leaves[i]));
+                }
+                return link_to(c);
+            }
+
+            case hamt_kind::branch: {
+                auto old = as_branch(node);
+                auto bit = std::uint32_t(1) << ((hash >> shift) & hamt_mask);
+                if (!(old->bitmap & bit)) return retain(node);
+
+                auto pos = popcount32(old->bitmap & (bit - 1));
+                auto child = erase(old->children[pos], shift + hamt_bits, hash, key, removed);
+                if (!removed) {
+                    release(child);
+                    return retain(node);
+                }
+
+                auto count = count_of(node);
+                if (child.pointer() == nullptr && count == 2 && kind_of(old->children[1 - pos]) != hamt_kind::branch) {
+                    return retain(old->children[1 - pos]);
+                }
+                if (child.pointer() != nullptr && count == 1 && kind_of(child) != hamt_kind::branch) {
+                    return child;
+                }
+                if (child.pointer() == nullptr && count == 1) {
+                    return hamt_link{};
+                }
+
+                auto b = new branch;
+                b->bitmap = child.pointer() != nullptr ? old->bitmap : old->bitmap & ~bit;
+                b->children.reserve(old->children.size());
+                for (std::size_t i = 0; i < old->children.size(); ++i) {
+                    if (i != pos) {
+                        b->children.push_back(retain(old->children[i]));
+                    }
+                    else if (child.pointer() != nullptr) {
+                        b->children.push_back(child);
+                    }
+                }
+                return link_to(b);
+            }
+            }
+            return node;
+        }
+
+        template <typename Fn>
+        static void for_each(hamt_link node, Fn &fn) {
+            if (node.pointer() == nullptr) return;
+
+            switch (kind_of(node)) {
+            case hamt_kind::leaf:
+                fn(as_leaf(node)->key, as_leaf(node)->value);
+                break;
+            case hamt_kind::branch:
+                for (auto child : as_branch(node)->children) for_each(child, fn);
+                break;
+            case hamt_kind::collision:
+                for (auto child : as_collision(node)->leaves) for_each(child, fn);
+                break;
+            }
+        }
+    };
+
+}
+
+// Hash maps each key to the 64 bit value that picks its path, five bits per
+// level; keys with equal hashes share a collision node.
+template <typename Value, typename Hash = string_hash_pendatic>
+class persistent_hash_map {
+
+    using trie = detail::hamt<Value>;
+
+    detail::hamt_link m_root;
+    std::size_t m_size = 0;
+
+    template <typename Key>
+    static std::uint64_t hash_of(const Key &key) noexcept {
+        return static_cast<std::uint64_t>(Hash{}(key));
+    }
+
+    inline void replace_root(detail::hamt_link root) noexcept {
+        trie::release(m_root);
+        m_root = root;
+    }
+
+public:
+
+    using key_type = strong_immutable_string;
+    using mapped_type = Value;
+    using size_type = std::size_t;
+
+    persistent_hash_map() = default;
+
+    // O(1): the copy shares every node with other.
+    persistent_hash_map(const persistent_hash_map &other) noexcept
+    :m_root{ detail::retain(other.m_root) }, m_size{ other.m_size }
+    {}
+
+    persistent_hash_map(persistent_hash_map &&other) noexcept
+    :m_root{ other.m_root }, m_size{ other.m_size }
+    {
+        other.m_root = detail::hamt_link{};
+        other.m_size = 0;
+    }
+
+    persistent_hash_map &operator=(const persistent_hash_map &other) noexcept {
+        replace_root(detail::retain(other.m_root));
+        m_size = other.m_size;
+        return *this;
+    }
+
+    persistent_hash_map &operator=(persistent_hash_map &&other) noexcept {
+        if (this != &other) {
+            replace_root(other.m_root);
+            m_size = other.m_size;
+            other.m_root = detail::hamt_link{};
+            other.m_size = 0;
+        }
+        return *this;
+    }
+
+    ~persistent_hash_map() {
+        trie::release(m_root);
+    }
+
+    inline size_type size() const noexcept {
+        return m_size;
+    }
+
+    inline bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline const Value* find(const Key &key) const noexcept {
+        return trie::find(m_root, hash_of(key), key);
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline bool contains(const Key &key) const noexcept {
+        return find(key) != nullptr;
+    }
+
+    // Sets key to value in this map only; copies taken earlier keep seeing
+    // the old value. Returns true if key was not present before.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    bool set(const Key &key, Value value) {
+        bool added = false;
+        replace_root(trie::insert(m_root, 0, hash_of(key), key, value, added));
+        m_size += added;
+        return added;
+    }
+
+    // Returns true if key was present.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    bool erase(const Key &key) {
+        bool removed = false;
+        auto root = trie::erase(m_root, 0, hash_of(key), key, removed);
+        if (!removed) {
+            trie::release(root);
+            return false;
+        }
+        replace_root(root);
+        --m_size;
+        return true;
+    }
+
+    // Same as set and erase, leaving this map as it is.
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    persistent_hash_map with(const Key &key, Value value) const {
+        persistent_hash_map copy{ *this };
+        copy.set(key, std::move(value));
+        return copy;
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    persistent_hash_map without(const Key &key) const {
+        persistent_hash_map copy{ *this };
+        copy.erase(key);
+        return copy;
+    }
+
+    // Calls fn(const strong_immutable_string&, const Value&) for every
+    // entry, in no particular order.
+    template <typename Fn>
+    void for_each(Fn fn) const {
+        trie::for_each(m_root, fn);
+    }
+};
@@ -0,0 +1,118 @@
+#include "test.h"
+#include "persistent_hash_map.h"
+
+#include <map>
+#include <string>
+
+namespace {
+
+    // Only looks at the length, so most keys collide.
+    struct length_hash {
+        template <typename T>
+        std::size_t operator()(const T &str) const noexcept {
+            return str.size();
+        }
+    };
+
+    std::string key_of(int i) {
+        return "key" + std::to_string(i);
+    }
+
+    template <typename Map>
+    void check_matches(const Map &map, const std::map<std::string, int> &expected) {
+        CHECK(map.size() == expected.size());
+        for (const auto &e : expected) {
+            auto found = map.find(weak_immutable_string_impl{ e.first.c_str(), static_cast<weak_immutable_string_impl::size_type>(e.first.size()) });
+            REQUIRE(found != nullptr);
+            CHECK(*found == e.second);
+        }
+
+        std::size_t visited = 0;
+        map.for_each([&](const strong_immutable_string &key, int value) {
+            auto it = expected.find(std::string{ key.data(), key.size() });
+            REQUIRE(it != expected.end());
+            CHECK(it->second == value);
+            ++visited;
+        });
+        CHECK(visited == expected.size());
+    }
+
+    template <typename Map>
+    void exercise() {
+        Map map;
+        std::map<std::string, int> expected;
+
+        for (int i = 0; i < 2000; ++i) {
+            weak_immutable_string key{ key_of(i) };
+            CHECK(map.set(key, i));
+            expected[key_of(i)] = i;
+        }
+        check_matches(map, expected);
+
+        Map snapshot = map;
+        auto snapshot_expected = expected;
+
+        for (int i = 0; i < 2000; i += 3) {
+            weak_immutable_string key{ key_of(i) };
+            CHECK(!map.set(key, -i));
+            expected[key_of(i)] = -i;
+        }
+        for (int i = 1; i < 2000; i += 3) {
+            weak_immutable_string key{ key_of(i) };
+            CHECK(map.erase(key));
+            CHECK(!map.erase(key));
+            expected.erase(key_of(i));
+        }
+
+        check_matches(map, expected);
+        check_matches(snapshot, snapshot_expected);
+
+        for (int i = 0; i < 2000; ++i) {
+            weak_immutable_string key{ key_of(i) };
+            map.erase(key);
+        }
+        CHECK(map.empty());
+        check_matches(snapshot, snapshot_expected);
+    }
+
+}
+
+TEST_CASE("persistent hash map") {
+    GIVEN("an empty map") {
+        persistent_hash_map<int> map;
+        CHECK(map.empty());
+        CHECK(map.find(weak_immutable_string{ "missing" }) == nullptr);
+        CHECK(!map.erase(weak_immutable_string{ "missing" }));
+    }
+
+    GIVEN("a map and a copy of it") {
+        persistent_hash_map<std::string> map;
+        map.set(weak_immutable_string{ "a" }, "1");
+        map.set(weak_immutable_string{ "b" }, "2");
+
+        auto copy = map;
+        map.set(weak_immutable_string{ "a" }, "changed");
+        map.set(weak_immutable_string{ "c" }, "3");
+
+        CHECK(*map.find(weak_immutable_string{ "a" }) == "changed");
+        CHECK(*copy.find(weak_immutable_string{ "a" }) == "1");
+        CHECK(copy.find(weak_immutable_string{ "c" }) == nullptr);
+        CHECK(copy.size() == 2);
+        CHECK(map.size() == 3);
+
+        auto without = map.without(weak_immutable_string{ "b" });
+        auto with = without.with(weak_immutable_string{ "d" }, "4");
+        CHECK(map.contains(weak_immutable_string{ "b" }));
+        CHECK(!without.contains(weak_immutable_string{ "b" }));
+        CHECK(!without.contains(weak_immutable_string{ "d" }));
+        CHECK(*with.find(weak_immutable_string{ "d" }) == "4");
+    }
+
+    GIVEN("many keys") {
+        exercise<persistent_hash_map<int>>();
+    }
+
+    GIVEN("many keys with colliding hashes") {
+        exercise<persistent_hash_map<int, length_hash>>();
+    }
+}
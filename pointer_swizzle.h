@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "ptr_int_pair_48va.h"
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+// Swizzled words keep the integer in the high 16 bits and replace the 48 bit
+// address by an (arena id, offset) pair:
+//
+//     | integer : 16 | arena id : 8 | offset : 40 |
+//
+// Arena ids are only meaningful relative to an arena_registry, which is
+// rebuilt (or rebound) by the loading process before unswizzling.
+class arena_registry {
+
+public:
+
+    using arena_id = std::uint8_t;
+
+    static constexpr int offset_bits = 40;
+    static constexpr int arena_id_bits = 8;
+    static constexpr std::uint64_t offset_mask = (std::uint64_t(1) << offset_bits) - 1;
+    static constexpr std::uint64_t max_arena_size = offset_mask;
+
+    // The last id encodes nullptr.
+    static constexpr std::size_t max_arenas = (std::size_t(1) << arena_id_bits) - 1;
+    static constexpr arena_id null_arena = static_cast<arena_id>(max_arenas);
+    static constexpr std::uint64_t null_word = (std::uint64_t(null_arena) << offset_bits) | offset_mask;
+
+    struct arena {
+        std::uintptr_t base;
+        std::size_t size;
+    };
+
+private:
+
+    static constexpr std::uint64_t low_bits_mask = (std::uint64_t(1) << 48) - 1;
+
+    struct range {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        arena_id id;
+    };
+
+    std::vector<arena> m_arenas;
+    std::vector<range> m_ranges; // sorted by begin
+
+    // Indexed by arena id. The null entry is chosen so that base + offset
+    // wraps to zero in the low 48 bits, which keeps unswizzling branch free.
+    std::uint64_t m_bases[max_arenas + 1] = {};
+
+    void rebuild_index() {
+        m_ranges.clear();
+        for (std::size_t i = 0; i < m_arenas.size(); ++i) {
+            m_ranges.push_back(range{ m_arenas[i].base, m_arenas[i].base + m_arenas[i].size, static_cast<arena_id>(i) });
+            m_bases[i] = m_arenas[i].base;
+        }
+        m_bases[null_arena] = (std::uint64_t(1) << 48) - offset_mask;
+
+        std::sort(m_ranges.begin(), m_ranges.end(), [](const range &lhs, const range &rhs) { return lhs.begin < rhs.begin; });
+        for (std::size_t i = 1; i < m_ranges.size(); ++i) {
+            if (m_ranges[i].begin < m_ranges[i - 1].end) {
+                throw std::invalid_argument{ "Overlapping arenas" };
+            }
+        }
+    }
+
+public:
+
+    arena_registry() {
+        m_bases[null_arena] = (std::uint64_t(1) << 48) - offset_mask;
+    }
+
+    arena_id add(const void* base, std::size_t size) {
+        if (m_arenas.size() == max_arenas) throw std::length_error{ "Too many arenas" };
+        if (size > max_arena_size) throw std::length_error{ "Arena too large" };
+
+        m_arenas.push_back(arena{ reinterpret_cast<std::uintptr_t>(base), size });
+        try {
+            rebuild_index();
+        }
+        catch (...) {
+            m_arenas.pop_back();
+            rebuild_index();
+            throw;
+        }
+        return static_cast<arena_id>(m_arenas.size() - 1);
+    }
+
+    // Points an existing id at the location the arena was loaded to.
+    void rebind(arena_id id, const void* base) {
+        ASSERT(id < m_arenas.size());
+        auto old_base = m_arenas[id].base;
+        m_arenas[id].base = reinterpret_cast<std::uintptr_t>(base);
+        try {
+            rebuild_index();
+        }
+        catch (...) {
+            m_arenas[id].base = old_base;
+            rebuild_index();
+            throw;
+        }
+    }
+
+    inline const arena &get(arena_id id) const {
+        ASSERT(id < m_arenas.size());
+        return m_arenas[id];
+    }
+
+    inline std::size_t size() const noexcept {
+        return m_arenas.size();
+    }
+
+    inline const std::uint64_t* bases() const noexcept {
+        return m_bases;
+    }
+
+    // Returns the swizzled low 48 bits for addr, or false if no arena owns it.
+    inline bool swizzle(std::uintptr_t addr, std::uint64_t &word) const noexcept {
+        if (addr == 0) {
+            word = null_word;
+            return true;
+        }
+
+        auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), addr,
+                                   [](std::uintptr_t a, const range &r) { return a < r.begin; });
+        if (it == m_ranges.begin()) return false;
+        --it;
+        if (addr >= it->end) return false;
+
+        word = (std::uint64_t(it->id) << offset_bits) | (addr - it->begin);
+        return true;
+    }
+
+    inline std::uint64_t unswizzle(std::uint64_t word) const noexcept {
+        return (m_bases[(word >> offset_bits) & max_arenas] + (word & offset_mask)) & low_bits_mask;
+    }
+};
+
+// Rewrites every pair in [first, last) into swizzled form in place, keeping
+// the integer. Returns the first pair whose pointer is not owned by any
+// arena (left untouched), or last on success.
+template <typename PtrType, typename IntType>
+ptr_int_pair_48va<PtrType, IntType>* swizzle(const arena_registry &registry,
+                                             ptr_int_pair_48va<PtrType, IntType>* first,
+                                             ptr_int_pair_48va<PtrType, IntType>* last)
+{
+    using pair_type = ptr_int_pair_48va<PtrType, IntType>;
+    constexpr std::uint64_t high_bits_mask = ~((std::uint64_t(1) << 48) - 1);
+
+    for (; first != last; ++first) {
+        std::uint64_t raw = first->raw();
+        std::uint64_t word;
+        if (!registry.swizzle(reinterpret_cast<std::uintptr_t>(first->pointer()), word)) {
+            return first;
+        }
+        *first = pair_type::from_raw((raw & high_bits_mask) | word);
+    }
+    return last;
+}
+
+// Inverse of swizzle() against a registry whose arenas have been rebound to
+// their new locations.
+template <typename PtrType, typename IntType>
+void unswizzle(const arena_registry &registry,
+               ptr_int_pair_48va<PtrType, IntType>* first,
+               ptr_int_pair_48va<PtrType, IntType>* last) noexcept
+{
+    using pair_type = ptr_int_pair_48va<PtrType, IntType>;
+    static_assert(sizeof(pair_type) == sizeof(std::uint64_t), "Alignment check failed");
+
+    constexpr std::uint64_t high_bits_mask = ~((std::uint64_t(1) << 48) - 1);
+
+#if defined(__AVX2__)
+    const __m256i offset_mask = _mm256_set1_epi64x(static_cast<long long>(arena_registry::offset_mask));
+    const __m256i id_mask = _mm256_set1_epi64x(static_cast<long long>(arena_registry::max_arenas));
+    const __m256i low_mask = _mm256_set1_epi64x(static_cast<long long>(~high_bits_mask));
+    const __m256i high_mask = _mm256_set1_epi64x(static_cast<long long>(high_bits_mask));
+    const auto bases = reinterpret_cast<const long long*>(registry.bases());
+
+    for (; last - first >= 4; first += 4) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+        __m256i id = _mm256_and_si256(_mm256_srli_epi64(w, arena_registry::offset_bits), id_mask);
+        __m256i base = _mm256_i64gather_epi64(bases, id, 8);
+        __m256i addr = _mm256_and_si256(_mm256_add_epi64(base, _mm256_and_si256(w, offset_mask)), low_mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(first), _mm256_or_si256(_mm256_and_si256(w, high_mask), addr));
+    }
+#endif
+
+    for (; first != last; ++first) {
+        std::uint64_t raw = first->raw();
+        *first = pair_type::from_raw((raw & high_bits_mask) | registry.unswizzle(raw));
+    }
+}
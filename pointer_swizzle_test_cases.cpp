@@ -0,0 +1,94 @@
+#include "test.h"
+#include "pointer_swizzle.h"
+
+#include <vector>
+
+namespace {
+
+    struct node {
+        int value;
+    };
+
+}
+
+TEST_CASE("pointer swizzling") {
+    using link = ptr_int_pair_48va<node, short>;
+
+    std::vector<node> first_arena(16), second_arena(8);
+    for (int i = 0; i < 16; ++i) first_arena[i].value = i;
+    for (int i = 0; i < 8; ++i) second_arena[i].value = 100 + i;
+
+    arena_registry registry;
+    auto first_id = registry.add(first_arena.data(), first_arena.size() * sizeof(node));
+    auto second_id = registry.add(second_arena.data(), second_arena.size() * sizeof(node));
+    REQUIRE(registry.size() == 2);
+
+    std::vector<link> links;
+    for (int i = 0; i < 16; ++i) {
+        links.emplace_back(&first_arena[15 - i], static_cast<short>(i));
+    }
+    for (int i = 0; i < 8; ++i) {
+        links.emplace_back(&second_arena[i], static_cast<short>(-i));
+    }
+    links.emplace_back(nullptr, 7);
+
+    GIVEN("a round trip in place") {
+        auto original = links;
+
+        REQUIRE(swizzle(registry, links.data(), links.data() + links.size()) == links.data() + links.size());
+        CHECK(links[0].integer() == 0);
+        CHECK(links[16].integer() == 0);
+        CHECK(links[17].integer() == -1);
+        CHECK((links[1].raw() >> arena_registry::offset_bits & 0xff) == first_id);
+        CHECK((links[1].raw() & arena_registry::offset_mask) == 14 * sizeof(node));
+        CHECK((links[17].raw() >> arena_registry::offset_bits & 0xff) == second_id);
+
+        unswizzle(registry, links.data(), links.data() + links.size());
+        CHECK(links == original);
+    }
+
+    GIVEN("relocated arenas") {
+        REQUIRE(swizzle(registry, links.data(), links.data() + links.size()) == links.data() + links.size());
+
+        std::vector<node> first_copy = first_arena, second_copy = second_arena;
+        registry.rebind(first_id, first_copy.data());
+        registry.rebind(second_id, second_copy.data());
+
+        unswizzle(registry, links.data(), links.data() + links.size());
+        for (int i = 0; i < 16; ++i) {
+            CHECK(links[i].pointer() == &first_copy[15 - i]);
+            CHECK(links[i].pointer()->value == 15 - i);
+            CHECK(links[i].integer() == i);
+        }
+        for (int i = 0; i < 8; ++i) {
+            CHECK(links[16 + i].pointer() == &second_copy[i]);
+            CHECK(links[16 + i].integer() == -i);
+        }
+        CHECK(links.back().pointer() == nullptr);
+        CHECK(links.back().integer() == 7);
+    }
+
+    GIVEN("a pointer outside every arena") {
+        node stray{ -1 };
+        links.insert(links.begin() + 3, link{ &stray, 1 });
+
+        auto failed = swizzle(registry, links.data(), links.data() + links.size());
+        CHECK(failed == links.data() + 3);
+        CHECK(failed->pointer() == &stray);
+    }
+
+    GIVEN("overlapping arenas") {
+        CHECK_THROWS_AS(registry.add(first_arena.data() + 4, sizeof(node)), std::invalid_argument);
+        CHECK(registry.size() == 2);
+    }
+
+    GIVEN("a rebind onto another arena") {
+        auto original = links;
+        CHECK_THROWS_AS(registry.rebind(second_id, first_arena.data() + 4), std::invalid_argument);
+        CHECK(registry.get(second_id).base == reinterpret_cast<std::uintptr_t>(second_arena.data()));
+
+        REQUIRE(swizzle(registry, links.data(), links.data() + links.size()) == links.data() + links.size());
+        unswizzle(registry, links.data(), links.data() + links.size());
+        CHECK(links == original);
+    }
+}
@@ -4,6 +4,20 @@
 #include <limits>
 #include <type_traits>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Under C++20 the accessors take a shift based path during constant
+// evaluation instead of reading the inactive union member, so pairs that
+// carry no address (nullptr plus an integer) can be built and compared at
+// compile time. Runtime code is unchanged.
+#ifdef __cpp_lib_is_constant_evaluated
+#define PTR_INT_PAIR_48VA_IS_CONSTANT_EVALUATED() std::is_constant_evaluated()
+#else
+#define PTR_INT_PAIR_48VA_IS_CONSTANT_EVALUATED() false
+#endif
+
 template <typename PtrType, typename IntType>
 class ptr_int_pair_48va {
     
@@ -23,6 +37,10 @@ private:
     static constexpr std::uintptr_t high_bits_mask_flip = ~high_bits_mask_set;
     static constexpr std::uintptr_t bit_47_mask = std::uintptr_t(1) << 47;
 
+    static constexpr int key_int_bits = 8 * sizeof(IntType);
+    static constexpr std::uintptr_t key_int_mask = (std::uintptr_t(1) << key_int_bits) - 1;
+    static constexpr std::uintptr_t key_sign_flip = std::is_signed<IntType>::value ? std::uintptr_t(1) << (key_int_bits - 1) : 0;
+
     static_assert(sizeof(void*) == ptr_size_requirement, "ptr_int_pair_48va is only supported on 64 bit machines");
     static_assert(sizeof(IntType) <= int_size_limit, "The given IntType is larger than 2 bytes");
     
@@ -79,14 +97,19 @@ private:
                                       : i_offset | ptr_raw;
     }
 
+    // Converting an address to an integer is never a constant expression,
+    // so only nullptr is accepted during constant evaluation.
     static constexpr std::uintptr_t compact_ptr_int_pair(PtrType* ptr, IntType i) {
-        return compact_ptr_int_pair_helper(reinterpret_cast<std::uintptr_t>(ptr), static_cast<std::uintptr_t>(i) << high_bits_offset);
+        return PTR_INT_PAIR_48VA_IS_CONSTANT_EVALUATED() && ptr == nullptr
+                   ? static_cast<std::uintptr_t>(i) << high_bits_offset
+                   : compact_ptr_int_pair_helper(reinterpret_cast<std::uintptr_t>(ptr), static_cast<std::uintptr_t>(i) << high_bits_offset);
     }
 
-    constexpr bool logical_lt_helper(std::uintptr_t lhs_ptr, std::uintptr_t rhs_ptr, const ptr_int_pair_48va &other) const {
-        return lhs_ptr < rhs_ptr ||
-               (lhs_ptr == rhs_ptr && integer() < other.integer());
-    }
+    struct raw_tag {};
+
+    constexpr ptr_int_pair_48va(raw_tag, std::uintptr_t raw)
+    :m_buffer{ raw }
+    {}
 
 public:
     
@@ -106,17 +129,52 @@ public:
     :m_buffer{ compact_ptr_int_pair(ptr, i) }
     {}
 
+    static constexpr ptr_int_pair_48va from_raw(std::uintptr_t raw) {
+        return ptr_int_pair_48va{ raw_tag{}, raw };
+    }
+
     //
     // Accessors
     //
 
     constexpr PtrType* pointer() const {
-        return is_bit_47_set(m_buffer.raw) ? reinterpret_cast<PtrType*>(m_buffer.raw | high_bits_mask_set)
-                                           : reinterpret_cast<PtrType*>(m_buffer.raw & high_bits_mask_flip);
+        return PTR_INT_PAIR_48VA_IS_CONSTANT_EVALUATED() && (m_buffer.raw & high_bits_mask_flip) == 0
+                   ? nullptr
+                   : is_bit_47_set(m_buffer.raw) ? reinterpret_cast<PtrType*>(m_buffer.raw | high_bits_mask_set)
+                                                 : reinterpret_cast<PtrType*>(m_buffer.raw & high_bits_mask_flip);
     }
 
     constexpr IntType integer() const {
-        return m_buffer.view.i.v;
+        return PTR_INT_PAIR_48VA_IS_CONSTANT_EVALUATED() ? static_cast<IntType>(m_buffer.raw >> high_bits_offset)
+                                                         : m_buffer.view.i.v;
+    }
+
+    // The encoded word, for bulk kernels that work on arrays of pairs.
+    constexpr std::uintptr_t raw() const {
+        return m_buffer.raw;
+    }
+
+    // The pointer bits shifted up with the integer in the low bits (sign bit
+    // flipped for signed types), so that unsigned order is logical order.
+    constexpr std::uint64_t logical_key() const {
+        return (m_buffer.raw << 16) | (((m_buffer.raw >> high_bits_offset) & key_int_mask) ^ key_sign_flip);
+    }
+
+    // Writes logical_key() of every pair in [first, last) to out.
+    static void logical_keys(const ptr_int_pair_48va* first, const ptr_int_pair_48va* last, std::uint64_t* out) noexcept {
+#if defined(__AVX2__)
+        const __m256i int_mask = _mm256_set1_epi64x(static_cast<long long>(key_int_mask));
+        const __m256i sign_flip = _mm256_set1_epi64x(static_cast<long long>(key_sign_flip));
+
+        for (; last - first >= 4; first += 4, out += 4) {
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            __m256i i = _mm256_xor_si256(_mm256_and_si256(_mm256_srli_epi64(w, high_bits_offset), int_mask), sign_flip);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_or_si256(_mm256_slli_epi64(w, 16), i));
+        }
+#endif
+        for (; first != last; ++first, ++out) {
+            *out = first->logical_key();
+        }
     }
 
     inline void pointer(PtrType* ptr) noexcept {
@@ -151,9 +209,7 @@ public:
     }
 
     constexpr bool logical_lt(const ptr_int_pair_48va &other) const {
-        return logical_lt_helper(m_buffer.raw & high_bits_mask_flip,
-                                 other.m_buffer.raw & high_bits_mask_flip,
-                                 other);
+        return logical_key() < other.logical_key();
     }
 
     constexpr bool opaque_lt(const ptr_int_pair_48va &other) const {
@@ -162,7 +218,7 @@ public:
 
     struct logical_comparator {
         constexpr bool operator()(const ptr_int_pair_48va &lhs, const ptr_int_pair_48va &rhs) const {
-            return lhs.logical_lt(rhs);
+            return lhs.logical_key() < rhs.logical_key();
         }
     };
 
@@ -846,4 +846,154 @@ TEST_CASE("containers") {
             CHECK(std::equal(s.begin(), s.end(), expected.begin()));
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("raw") {
+    GIVEN("int short pair") {
+        int x = 1;
+        ptr_int_pair_48va<int, short> p{ &x, -2 };
+
+        auto q = ptr_int_pair_48va<int, short>::from_raw(p.raw());
+        CHECK(q == p);
+        CHECK(q.pointer() == &x);
+        CHECK(q.integer() == -2);
+    }
+
+    GIVEN("pointer bit extension") {
+        char* ptr = reinterpret_cast<char*>(~std::uintptr_t{ 0 });
+        ptr_int_pair_48va<char, short> p{ ptr, 3 };
+
+        CHECK(p.raw() == ((std::uintptr_t{ 3 } << 48) | 0xffffffffffff));
+        CHECK(ptr_int_pair_48va<char, short>::from_raw(p.raw()).pointer() == ptr);
+    }
+
+    GIVEN("default constructed") {
+        constexpr ptr_int_pair_48va<int, short> p;
+        static_assert(p.raw() == 0, "Default constructed pairs should be all zero");
+
+        CHECK(ptr_int_pair_48va<int, short>::from_raw(0) == p);
+    }
+}
+
+#ifdef __cpp_lib_is_constant_evaluated
+TEST_CASE("constant evaluation") {
+    using pair_type = ptr_int_pair_48va<const char, short>;
+
+    GIVEN("nullptr and integer") {
+        constexpr pair_type p{ nullptr, -42 };
+        static_assert(p.pointer() == nullptr, "");
+        static_assert(p.integer() == -42, "");
+        static_assert(p.raw() == std::uintptr_t(0xffd6) << 48, "");
+
+        CHECK(p.pointer() == nullptr);
+        CHECK(p.integer() == -42);
+    }
+
+    GIVEN("char integer") {
+        constexpr ptr_int_pair_48va<int, char> p{ nullptr, -1 };
+        static_assert(p.integer() == -1, "");
+
+        CHECK(p.integer() == -1);
+    }
+
+    GIVEN("a static table") {
+        static constexpr pair_type table[] = { { nullptr, 3 }, { nullptr, -1 }, { nullptr, 7 } };
+        static_assert(table[0] != table[2], "");
+        static_assert(table[1].logical_lt(table[0]), "");
+        static_assert(table[0].opaque_lt(table[1]), "");
+        static_assert(pair_type::logical_comparator{}(table[0], table[2]), "");
+        static_assert(pair_type::from_raw(table[2].raw()) == table[2], "");
+
+        CHECK(table[2].integer() == 7);
+        CHECK(table[1].logical_lt(table[0]));
+    }
+}
+#endif
+
+namespace {
+
+    // The ordering logical_lt had before it compared keys: the low 48 bits
+    // unsigned, then the integers as IntType.
+    template <typename Pair>
+    bool reference_logical_lt(const Pair &lhs, const Pair &rhs) {
+        const std::uint64_t lhs_ptr = lhs.raw() & 0xFFFFFFFFFFFFULL;
+        const std::uint64_t rhs_ptr = rhs.raw() & 0xFFFFFFFFFFFFULL;
+        return lhs_ptr < rhs_ptr || (lhs_ptr == rhs_ptr && lhs.integer() < rhs.integer());
+    }
+
+    template <typename Pair>
+    bool matches_reference_order(const std::vector<Pair> &pairs) {
+        typename Pair::logical_comparator comparator;
+        std::vector<std::uint64_t> keys(pairs.size());
+        Pair::logical_keys(pairs.data(), pairs.data() + pairs.size(), keys.data());
+
+        bool all_match = true;
+        for (std::size_t i = 0; i < pairs.size(); ++i) {
+            all_match = all_match && keys[i] == pairs[i].logical_key();
+            for (std::size_t j = 0; j < pairs.size(); ++j) {
+                const bool expected = reference_logical_lt(pairs[i], pairs[j]);
+                all_match = all_match &&
+                            pairs[i].logical_lt(pairs[j]) == expected &&
+                            comparator(pairs[i], pairs[j]) == expected &&
+                            (keys[i] < keys[j]) == expected &&
+                            (keys[i] == keys[j]) == (pairs[i] == pairs[j]);
+            }
+        }
+        return all_match;
+    }
+
+}
+
+TEST_CASE("logical key") {
+    int values[4] = {};
+
+    GIVEN("two byte integers") {
+        using pair_type = ptr_int_pair_48va<int, short>;
+
+        std::vector<pair_type> pairs;
+        for (auto &v : values) {
+            for (short i : { -32768, -32767, -257, -256, -129, -128, -1, 0, 1, 127, 128, 255, 256, 32766, 32767 }) {
+                pairs.emplace_back(&v, i);
+            }
+        }
+        pairs.emplace_back(nullptr, -5);
+        pairs.emplace_back(nullptr, 5);
+        pairs.emplace_back(reinterpret_cast<int*>(std::uintptr_t(0xffff800000000010)), 2);
+        pairs.emplace_back(reinterpret_cast<int*>(std::uintptr_t(0xffff800000000010)), -2);
+
+        CHECK(matches_reference_order(pairs));
+    }
+
+    GIVEN("one byte integers") {
+        using pair_type = ptr_int_pair_48va<int, signed char>;
+
+        std::vector<pair_type> pairs;
+        for (auto &v : { &values[0], &values[1] }) {
+            for (int i = -128; i <= 127; ++i) {
+                pairs.emplace_back(v, static_cast<signed char>(i));
+            }
+        }
+        pairs.emplace_back(nullptr, -1);
+        pairs.emplace_back(nullptr, 0);
+
+        CHECK(matches_reference_order(pairs));
+
+        pair_type a{ &values[0], -1 }, b{ &values[0], 1 };
+        a.integer(100);
+        CHECK(reference_logical_lt(b, a));
+        CHECK(b.logical_key() < a.logical_key());
+    }
+
+    GIVEN("unsigned integers") {
+        using pair_type = ptr_int_pair_48va<int, unsigned short>;
+
+        std::vector<pair_type> pairs;
+        for (auto &v : values) {
+            for (unsigned short i : { 0, 1, 127, 128, 255, 256, 32767, 32768, 65535 }) {
+                pairs.emplace_back(&v, i);
+            }
+        }
+
+        CHECK(matches_reference_order(pairs));
+    }
+}
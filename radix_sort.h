@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.h"
+#include "ptr_int_pair_48va.h"
+
+// LSD radix sorts over contiguous arrays of ptr_int_pair_48va. Both sorts
+// are stable. Every pass is split across threads: each thread histograms its
+// own chunk, the per thread counts are turned into disjoint output offsets,
+// and each thread scatters its chunk. Byte positions that hold the same value
+// for every element are skipped, so arrays of pointers into one region with
+// few distinct integers usually need far fewer than eight passes.
+
+namespace detail {
+
+    static constexpr std::size_t radix_sort_threshold = 1 << 12;
+    static constexpr std::size_t radix_sort_min_chunk = 1 << 16;
+    static constexpr std::size_t radix_digits = 256;
+    static constexpr std::size_t radix_passes = 8;
+
+    template <typename PtrType, typename IntType>
+    struct opaque_radix_key {
+        constexpr std::uint64_t operator()(const ptr_int_pair_48va<PtrType, IntType> &p) const {
+            return p.raw();
+        }
+    };
+
+    template <typename PtrType, typename IntType>
+    struct logical_radix_key {
+        constexpr std::uint64_t operator()(const ptr_int_pair_48va<PtrType, IntType> &p) const {
+            return p.logical_key();
+        }
+    };
+
+    template <typename T, typename Key>
+    void radix_sort(T* first, T* last, Key key, std::size_t threads) {
+        const std::size_t n = static_cast<std::size_t>(last - first);
+        if (n < radix_sort_threshold) {
+            std::stable_sort(first, last, [key](const T &lhs, const T &rhs) { return key(lhs) < key(rhs); });
+            return;
+        }
+
+        threads = worker_count(threads, n, radix_sort_min_chunk);
+
+        auto chunk_begin = [n, threads](std::size_t t) { return n * t / threads; };
+
+        // Digit counts over the whole input don't change between passes, so
+        // one sweep finds every byte position that can be skipped.
+        std::vector<std::size_t> counts(threads * radix_passes * radix_digits);
+        run_on_threads(threads, [&](std::size_t t) {
+            auto local = &counts[t * radix_passes * radix_digits];
+            for (auto i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                auto k = key(first[i]);
+                for (std::size_t pass = 0; pass < radix_passes; ++pass) {
+                    ++local[pass * radix_digits + ((k >> (8 * pass)) & 0xff)];
+                }
+            }
+        });
+
+        bool needed[radix_passes] = {};
+        for (std::size_t pass = 0; pass < radix_passes; ++pass) {
+            for (std::size_t d = 0; d < radix_digits && !needed[pass]; ++d) {
+                std::size_t total = 0;
+                for (std::size_t t = 0; t < threads; ++t) {
+                    total += counts[(t * radix_passes + pass) * radix_digits + d];
+                }
+                needed[pass] = total != 0 && total != n;
+            }
+        }
+
+        std::vector<T> buffer(n);
+        T* from = first;
+        T* to = buffer.data();
+        std::vector<std::size_t> offsets(threads * radix_digits);
+
+        for (std::size_t pass = 0; pass < radix_passes; ++pass) {
+            if (!needed[pass]) continue;
+            const int shift = static_cast<int>(8 * pass);
+
+            run_on_threads(threads, [&](std::size_t t) {
+                auto local = &offsets[t * radix_digits];
+                std::fill(local, local + radix_digits, std::size_t(0));
+                for (auto i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                    ++local[(key(from[i]) >> shift) & 0xff];
+                }
+            });
+
+            // Digit major, thread minor, which keeps the scatter stable.
+            std::size_t sum = 0;
+            for (std::size_t d = 0; d < radix_digits; ++d) {
+                for (std::size_t t = 0; t < threads; ++t) {
+                    auto count = offsets[t * radix_digits + d];
+                    offsets[t * radix_digits + d] = sum;
+                    sum += count;
+                }
+            }
+
+            run_on_threads(threads, [&](std::size_t t) {
+                auto local = &offsets[t * radix_digits];
+                for (auto i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+                    to[local[(key(from[i]) >> shift) & 0xff]++] = from[i];
+                }
+            });
+
+            std::swap(from, to);
+        }
+
+        if (from != first) {
+            run_on_threads(threads, [&](std::size_t t) {
+                std::copy(from + chunk_begin(t), from + chunk_begin(t + 1), first + chunk_begin(t));
+            });
+        }
+    }
+
+}
+
+// Sorts [first, last) by opaque_lt. threads == 0 uses every hardware thread;
+// small inputs are sorted with std::stable_sort on the calling thread.
+template <typename PtrType, typename IntType>
+void radix_sort_opaque(ptr_int_pair_48va<PtrType, IntType>* first,
+                       ptr_int_pair_48va<PtrType, IntType>* last,
+                       std::size_t threads = 0)
+{
+    detail::radix_sort(first, last, detail::opaque_radix_key<PtrType, IntType>{}, threads);
+}
+
+// Sorts [first, last) by logical_lt.
+template <typename PtrType, typename IntType>
+void radix_sort_logical(ptr_int_pair_48va<PtrType, IntType>* first,
+                        ptr_int_pair_48va<PtrType, IntType>* last,
+                        std::size_t threads = 0)
+{
+    detail::radix_sort(first, last, detail::logical_radix_key<PtrType, IntType>{}, threads);
+}
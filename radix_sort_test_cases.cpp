@@ -0,0 +1,79 @@
+#include "test.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+    template <typename IntType>
+    std::vector<ptr_int_pair_48va<int, IntType>> random_pairs(std::size_t count, std::size_t distinct_ptrs, std::vector<int> &storage) {
+        std::mt19937_64 rng{ 7 };
+        std::uniform_int_distribution<std::size_t> ptr{ 0, distinct_ptrs - 1 };
+        std::uniform_int_distribution<int> integer{ -300, 300 };
+
+        storage.resize(distinct_ptrs);
+        std::vector<ptr_int_pair_48va<int, IntType>> pairs;
+        for (std::size_t i = 0; i < count; ++i) {
+            pairs.emplace_back(&storage[ptr(rng)], static_cast<IntType>(integer(rng)));
+        }
+        return pairs;
+    }
+
+}
+
+TEST_CASE("radix sort") {
+    std::vector<int> storage;
+
+    GIVEN("pairs with a signed integer") {
+        using pair_type = ptr_int_pair_48va<int, short>;
+
+        for (std::size_t count : { std::size_t(0), std::size_t(1), std::size_t(1000), std::size_t(200000) }) {
+            auto pairs = random_pairs<short>(count, 5000, storage);
+
+            auto opaque = pairs;
+            std::stable_sort(opaque.begin(), opaque.end(), pair_type::opaque_comparator{});
+            auto logical = pairs;
+            std::stable_sort(logical.begin(), logical.end(), pair_type::logical_comparator{});
+
+            for (std::size_t threads : { 1, 4 }) {
+                auto sorted = pairs;
+                radix_sort_opaque(sorted.data(), sorted.data() + sorted.size(), threads);
+                CHECK(sorted == opaque);
+
+                sorted = pairs;
+                radix_sort_logical(sorted.data(), sorted.data() + sorted.size(), threads);
+                CHECK(sorted == logical);
+            }
+        }
+    }
+
+    GIVEN("pairs with a one byte integer") {
+        using pair_type = ptr_int_pair_48va<int, signed char>;
+
+        auto pairs = random_pairs<signed char>(100000, 64, storage);
+        auto expected = pairs;
+        std::stable_sort(expected.begin(), expected.end(), pair_type::logical_comparator{});
+
+        radix_sort_logical(pairs.data(), pairs.data() + pairs.size(), 3);
+        CHECK(pairs == expected);
+    }
+
+    GIVEN("constant byte positions") {
+        using pair_type = ptr_int_pair_48va<int, unsigned short>;
+
+        storage.resize(1);
+        std::vector<pair_type> pairs;
+        for (int i = 0; i < 50000; ++i) {
+            pairs.emplace_back(&storage[0], static_cast<unsigned short>((i * 7919) % 50000));
+        }
+        pairs.emplace_back(nullptr, 3);
+
+        auto expected = pairs;
+        std::stable_sort(expected.begin(), expected.end(), pair_type::opaque_comparator{});
+
+        radix_sort_opaque(pairs.data(), pairs.data() + pairs.size());
+        CHECK(pairs == expected);
+    }
+}
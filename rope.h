@@ -0,0 +1,448 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "immutable_string.h"
+#include "ptr_int_pair_48va.h"
+
+// A persistent rope for text too large for the 16 bit size of an immutable
+// string. Leaves are strong_immutable_string chunks; concat nodes hold two
+// ptr_int_pair_48va links whose tag caches the depth of the subtree they
+// point at (0 for a leaf), which is all the AVL join needs. Nodes are shared
+// between ropes and never change, so copies are O(1) and concat, split,
+// substr, insert and erase are O(log n) plus at most two leaf copies.
+
+namespace detail {
+
+    struct rope_node {
+        mutable std::atomic<std::uint32_t> refs{ 1 };
+    };
+
+    using rope_link = ptr_int_pair_48va<const rope_node, std::uint16_t>;
+
+    // Flat text is cut into leaves of this size, and adjacent leaves that
+    // fit in one together are merged when joined, so repeated small edits
+    // don't leave a trail of tiny leaves behind.
+    static constexpr std::size_t rope_leaf_size = 1 << 12;
+
+    struct rope_leaf : rope_node {
+        strong_immutable_string text;
+
+        rope_leaf(const char* str, std::size_t len)
+        :text{ str, static_cast<strong_immutable_string::size_type>(len) }
+        {}
+
+        explicit rope_leaf(weak_immutable_string &&str)
+        :text{ std::move(str) }
+        {}
+    };
+
+    struct rope_concat : rope_node {
+        std::size_t length;
+        rope_link left;
+        rope_link right;
+    };
+
+    struct rope_tree {
+
+        static const rope_leaf* as_leaf(rope_link link) noexcept {
+            return static_cast<const rope_leaf*>(link.pointer());
+        }
+
+        static const rope_concat* as_concat(rope_link link) noexcept {
+            return static_cast<const rope_concat*>(link.pointer());
+        }
+
+        static int depth(rope_link link) noexcept {
+            return link.integer();
+        }
+
+        static bool is_leaf(rope_link link) noexcept {
+            return link.pointer() != nullptr && link.integer() == 0;
+        }
+
+        static std::size_t length(rope_link link) noexcept {
+            if (link.pointer() == nullptr) return 0;
+            return is_leaf(link) ? as_leaf(link)->text.size() : as_concat(link)->length;
+        }
+
+        static rope_link retain(rope_link link) noexcept {
+            if (link.pointer() != nullptr) {
+                link.pointer()->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+            return link;
+        }
+
+        static void release(rope_link link) noexcept {
+            auto node = link.pointer();
+            if (node == nullptr || node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+            if (is_leaf(link)) {
+                delete as_leaf(link);
+            }
+            else {
+                release(as_concat(link)->left);
+                release(as_concat(link)->right);
+                delete as_concat(link);
+            }
+        }
+
+        static rope_link make_leaf(const char* str, std::size_t len) {
+            return len == 0 ? rope_link{} : rope_link{ new rope_leaf{ str, len }, 0 };
+        }
+
+        // Everything below takes ownership of the links passed by value
+        // and returns an owned link; links passed as const& are borrowed.
+
+        static rope_link make_concat(rope_link left, rope_link right) {
+            auto node = new rope_concat;
+            node->length = length(left) + length(right);
+            node->left = left;
+            node->right = right;
+            auto d = depth(left) > depth(right) ? depth(left) : depth(right);
+            return rope_link{ node, static_cast<std::uint16_t>(d + 1) };
+        }
+
+        // Splits an owned concat node into owned references to its children.
+        static std::pair<rope_link, rope_link> expose(rope_link link) {
+            auto node = as_concat(link);
+            std::pair<rope_link, rope_link> children{ retain(node->left), retain(node->right) };
+            release(link);
+            return children;
+        }
+
+        // Builds a node from subtrees whose depths differ by at most two,
+        // rotating once or twice when they differ by exactly two.
+        static rope_link balance(rope_link left, rope_link right) {
+            if (depth(right) > depth(left) + 1) {
+                auto r = expose(right);
+                if (depth(r.first) > depth(r.second)) {
+                    auto rl = expose(r.first);
+                    return make_concat(make_concat(left, rl.first), make_concat(rl.second, r.second));
+                }
+                return make_concat(make_concat(left, r.first), r.second);
+            }
+            if (depth(left) > depth(right) + 1) {
+                auto l = expose(left);
+                if (depth(l.second) > depth(l.first)) {
+                    auto lr = expose(l.second);
+                    return make_concat(make_concat(l.first, lr.first), make_concat(lr.second, right));
+                }
+                return make_concat(l.first, make_concat(l.second, right));
+            }
+            return make_concat(left, right);
+        }
+
+        static rope_link join(rope_link left, rope_link right) {
+            if (left.pointer() == nullptr) return right;
+            if (right.pointer() == nullptr) return left;
+
+            if (depth(left) > depth(right) + 1) {
+                auto l = expose(left);
+                return balance(l.first, join(l.second, right));
+            }
+            if (depth(right) > depth(left) + 1) {
+                auto r = expose(right);
+                return balance(join(left, r.first), r.second);
+            }
+
+            if (is_leaf(left) && is_leaf(right) && length(left) + length(right) <= rope_leaf_size) {
+                auto l = as_leaf(left);
+                auto r = as_leaf(right);
+                std::string merged;
+                merged.reserve(l->text.size() + r->text.size());
+                merged.append(l->text.data(), l->text.size()).append(r->text.data(), r->text.size());
+                release(left);
+                release(right);
+                return make_leaf(merged.data(), merged.size());
+            }
+            return make_concat(left, right);
+        }
+
+        static std::pair<rope_link, rope_link> split(const rope_link &link, std::size_t pos) {
+            if (pos == 0) return { rope_link{}, retain(link) };
+            if (pos >= length(link)) return { retain(link), rope_link{} };
+
+            if (is_leaf(link)) {
+                auto &text = as_leaf(link)->text;
+                return { make_leaf(text.data(), pos), make_leaf(text.data() + pos, text.size() - pos) };
+            }
+
+            auto node = as_concat(link);
+            auto left_length = length(node->left);
+            if (pos < left_length) {
+                auto parts = split(node->left, pos);
+                return { parts.first, join(parts.second, retain(node->right)) };
+            }
+            auto parts = split(node->right, pos - left_length);
+            return { join(retain(node->left), parts.first), parts.second };
+        }
+
+        // Subtrees over [first, last) of leaves, which differ in depth by at
+        // most one at every level.
+        static rope_link build(const rope_link* first, const rope_link* last) {
+            if (last - first == 1) return *first;
+            auto middle = first + (last - first) / 2;
+            return make_concat(build(first, middle), build(middle, last));
+        }
+
+        static rope_link build(const char* str, std::size_t len) {
+            if (len == 0) return rope_link{};
+
+            std::vector<rope_link> leaves;
+            leaves.reserve((len + rope_leaf_size - 1) / rope_leaf_size);
+            for (std::size_t pos = 0; pos < len; pos += rope_leaf_size) {
+                leaves.push_back(make_leaf(str + pos, len - pos < rope_leaf_size ? len - pos : rope_leaf_size));
+            }
+            return build(leaves.data(), leaves.data() + leaves.size());
+        }
+    };
+
+}
+
+class rope {
+
+    using tree = detail::rope_tree;
+
+    detail::rope_link m_root;
+
+    explicit rope(detail::rope_link root) noexcept
+    :m_root{ root }
+    {}
+
+public:
+
+    using size_type = std::size_t;
+    using chunk_type = weak_immutable_string_impl;
+
+    // Walks the leaves left to right. Holds pointers into the rope, which
+    // must outlive it.
+    class chunk_iterator {
+
+        std::vector<const detail::rope_concat*> m_stack;
+        const detail::rope_leaf* m_leaf = nullptr;
+
+        friend class rope;
+
+        inline void descend(detail::rope_link link) {
+            while (link.pointer() != nullptr && !tree::is_leaf(link)) {
+                m_stack.push_back(tree::as_concat(link));
+                link = tree::as_concat(link)->left;
+            }
+            m_leaf = tree::as_leaf(link);
+        }
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = chunk_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const chunk_type*;
+        using reference = chunk_type;
+
+        chunk_iterator() = default;
+
+        inline chunk_type operator*() const {
+            return chunk_type{ m_leaf->text };
+        }
+
+        chunk_iterator &operator++() {
+            m_leaf = nullptr;
+            if (!m_stack.empty()) {
+                auto node = m_stack.back();
+                m_stack.pop_back();
+                descend(node->right);
+            }
+            return *this;
+        }
+
+        chunk_iterator operator++(int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        inline bool operator==(const chunk_iterator &other) const noexcept {
+            return m_leaf == other.m_leaf;
+        }
+
+        inline bool operator!=(const chunk_iterator &other) const noexcept {
+            return m_leaf != other.m_leaf;
+        }
+    };
+
+    struct chunk_range {
+        chunk_iterator first;
+        chunk_iterator last;
+
+        inline chunk_iterator begin() const {
+            return first;
+        }
+
+        inline chunk_iterator end() const {
+            return last;
+        }
+    };
+
+    rope() = default;
+
+    explicit rope(const char* str, size_type len)
+    :m_root{ tree::build(str, len) }
+    {}
+
+    rope(const char* str)
+    :rope{ str, std::strlen(str) }
+    {}
+
+    template <typename Traits, typename Allocator>
+    rope(const std::basic_string<char, Traits, Allocator> &str)
+    :rope{ str.data(), str.size() }
+    {}
+
+    // Adopts the buffer of str as a single leaf.
+    explicit rope(weak_immutable_string &&str)
+    :m_root{ str.empty() ? detail::rope_link{} : detail::rope_link{ new detail::rope_leaf{ std::move(str) }, 0 } }
+    {}
+
+    rope(const rope &other) noexcept
+    :m_root{ tree::retain(other.m_root) }
+    {}
+
+    rope(rope &&other) noexcept
+    :m_root{ other.m_root }
+    {
+        other.m_root = detail::rope_link{};
+    }
+
+    rope &operator=(const rope &other) noexcept {
+        auto root = tree::retain(other.m_root);
+        tree::release(m_root);
+        m_root = root;
+        return *this;
+    }
+
+    rope &operator=(rope &&other) noexcept {
+        if (this != &other) {
+            tree::release(m_root);
+            m_root = other.m_root;
+            other.m_root = detail::rope_link{};
+        }
+        return *this;
+    }
+
+    ~rope() {
+        tree::release(m_root);
+    }
+
+    inline size_type size() const noexcept {
+        return tree::length(m_root);
+    }
+
+    inline size_type length() const noexcept {
+        return size();
+    }
+
+    NODISCARD inline bool empty() const noexcept {
+        return m_root.pointer() == nullptr;
+    }
+
+    inline int depth() const noexcept {
+        return tree::depth(m_root);
+    }
+
+    char operator[](size_type pos) const {
+        ASSERT(pos < size());
+        auto link = m_root;
+        while (!tree::is_leaf(link)) {
+            auto node = tree::as_concat(link);
+            auto left_length = tree::length(node->left);
+            if (pos < left_length) {
+                link = node->left;
+            }
+            else {
+                pos -= left_length;
+                link = node->right;
+            }
+        }
+        return tree::as_leaf(link)->text[static_cast<chunk_type::size_type>(pos)];
+    }
+
+    friend rope operator+(const rope &lhs, const rope &rhs) {
+        return rope{ tree::join(tree::retain(lhs.m_root), tree::retain(rhs.m_root)) };
+    }
+
+    rope &append(const rope &other) {
+        m_root = tree::join(m_root, tree::retain(other.m_root));
+        return *this;
+    }
+
+    rope &operator+=(const rope &other) {
+        return append(other);
+    }
+
+    // The text before and after pos.
+    std::pair<rope, rope> split(size_type pos) const {
+        auto parts = tree::split(m_root, pos);
+        return { rope{ parts.first }, rope{ parts.second } };
+    }
+
+    rope substr(size_type pos, size_type len = static_cast<size_type>(-1)) const {
+        ASSERT(pos <= size());
+        auto tail = tree::split(m_root, pos);
+        tree::release(tail.first);
+        auto parts = tree::split(tail.second, len);
+        tree::release(tail.second);
+        tree::release(parts.second);
+        return rope{ parts.first };
+    }
+
+    rope &insert(size_type pos, const rope &text) {
+        ASSERT(pos <= size());
+        auto parts = tree::split(m_root, pos);
+        tree::release(m_root);
+        m_root = tree::join(tree::join(parts.first, tree::retain(text.m_root)), parts.second);
+        return *this;
+    }
+
+    rope &erase(size_type pos, size_type len = static_cast<size_type>(-1)) {
+        ASSERT(pos <= size());
+        auto head = tree::split(m_root, pos);
+        tree::release(m_root);
+        auto tail = tree::split(head.second, len);
+        tree::release(head.second);
+        tree::release(tail.first);
+        m_root = tree::join(head.first, tail.second);
+        return *this;
+    }
+
+    chunk_iterator chunks_begin() const {
+        chunk_iterator it;
+        it.descend(m_root);
+        return it;
+    }
+
+    chunk_iterator chunks_end() const {
+        return chunk_iterator{};
+    }
+
+    // for (auto chunk : r.chunks()) out.write(chunk.data(), chunk.size());
+    chunk_range chunks() const {
+        return chunk_range{ chunks_begin(), chunks_end() };
+    }
+
+    std::string str() const {
+        std::string out;
+        out.reserve(size());
+        for (auto chunk : chunks()) {
+            out.append(chunk.data(), chunk.size());
+        }
+        return out;
+    }
+};
@@ -0,0 +1,111 @@
+#include "test.h"
+#include "rope.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace {
+
+    std::string text_of(std::size_t len, unsigned seed) {
+        std::mt19937 rng{ seed };
+        std::string s(len, ' ');
+        for (auto &c : s) c = static_cast<char>('a' + rng() % 26);
+        return s;
+    }
+
+    // AVL trees over n leaves are at most about 1.44 log2(n) deep.
+    void check_balanced(const rope &r) {
+        std::size_t leaves = 0;
+        for (auto chunk : r.chunks()) {
+            CHECK(!chunk.empty());
+            ++leaves;
+        }
+        if (leaves > 1) {
+            CHECK(r.depth() <= 1.45 * std::log2(static_cast<double>(leaves)) + 2);
+        }
+    }
+
+}
+
+TEST_CASE("rope") {
+    GIVEN("an empty rope") {
+        rope r;
+        CHECK(r.empty());
+        CHECK(r.size() == 0);
+        CHECK(r.str().empty());
+        CHECK(r.chunks().begin() == r.chunks().end());
+        CHECK((r + rope{ "abc" }).str() == "abc");
+    }
+
+    GIVEN("text larger than an immutable string") {
+        auto text = text_of(300000, 1);
+        rope r{ text };
+
+        CHECK(r.size() == text.size());
+        CHECK(r.str() == text);
+        CHECK(r[0] == text[0]);
+        CHECK(r[123456] == text[123456]);
+        CHECK(r[text.size() - 1] == text.back());
+        check_balanced(r);
+
+        CHECK(r.substr(1000, 70000).str() == text.substr(1000, 70000));
+        CHECK(r.substr(299990).str() == text.substr(299990));
+
+        auto parts = r.split(150001);
+        CHECK(parts.first.str() == text.substr(0, 150001));
+        CHECK(parts.second.str() == text.substr(150001));
+        CHECK((parts.first + parts.second).str() == text);
+    }
+
+    GIVEN("an adopted buffer") {
+        rope r{ weak_immutable_string{ "hello" } };
+        r += rope{ " world" };
+        CHECK(r.str() == "hello world");
+    }
+
+    GIVEN("random edits") {
+        std::mt19937 rng{ 42 };
+        auto text = text_of(50000, 2);
+        rope r{ text };
+        rope before = r;
+        auto before_text = text;
+
+        for (int i = 0; i < 2000; ++i) {
+            auto pos = rng() % (text.size() + 1);
+            if (rng() % 3 != 0 || text.size() < 100) {
+                auto piece = text_of(1 + rng() % (rng() % 8 == 0 ? 10000 : 20), rng());
+                r.insert(pos, rope{ piece });
+                text.insert(pos, piece);
+            }
+            else {
+                auto len = rng() % 200;
+                r.erase(pos, len);
+                text.erase(pos, len);
+            }
+            REQUIRE(r.size() == text.size());
+        }
+
+        CHECK(r.str() == text);
+        check_balanced(r);
+        CHECK(before.str() == before_text);
+    }
+
+    GIVEN("one character appended at a time") {
+        rope r;
+        std::string text;
+        for (int i = 0; i < 20000; ++i) {
+            r += rope{ std::string(1, static_cast<char>('a' + i % 26)) };
+            text += static_cast<char>('a' + i % 26);
+        }
+        CHECK(r.str() == text);
+        check_balanced(r);
+
+        std::size_t chunks = 0;
+        for (auto chunk : r.chunks()) {
+            (void)chunk;
+            ++chunks;
+        }
+        CHECK(chunks <= text.size() / 2048 + 1);
+    }
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "immutable_string.h"
+#include "offset_ptr_int_pair.h"
+
+// An append-only, deduplicating string pool living in a POSIX shared memory
+// segment, so that processes on one host can share a single copy of each
+// string. Any thread of any process that has the segment open may intern
+// strings concurrently: records are bump allocated and published through a
+// lock-free open addressing table inside the segment.
+//
+// Every process maps the segment at its own address, so handles store the
+// offset from the start of the mapping (offset_ptr_int_pair with a segment
+// policy) and the size. Their bits mean the same thing in every process and
+// can be stored in the segment or sent elsewhere as they are.
+//
+// The segment policy is a static, so each Tag can have one pool open per
+// process at a time.
+
+namespace detail {
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared string pool needs address free 64 bit atomics");
+
+    struct shared_pool_header {
+        static constexpr std::uint64_t ready_magic = 0x6c6f6f7072747373ULL;
+
+        std::atomic<std::uint64_t> ready;
+        std::uint64_t size;
+        std::uint64_t bucket_count;
+        std::uint64_t data_begin;
+        std::atomic<std::uint64_t> used;
+        std::atomic<std::uint64_t> count;
+    };
+
+    struct shared_pool_record {
+        std::uint64_t hash;
+        std::uint16_t size;
+        char data[1];
+    };
+
+    static constexpr std::size_t shared_pool_record_overhead = offsetof(shared_pool_record, data) + 1;
+    static constexpr std::size_t shared_pool_bytes_per_bucket = 64;
+
+}
+
+template <typename Tag>
+class basic_shared_string_pool {
+
+    static char* &mapping() noexcept {
+        static char* base = nullptr;
+        return base;
+    }
+
+public:
+
+    struct segment {
+        static const void* base() noexcept {
+            return mapping();
+        }
+    };
+
+    using handle = offset_ptr_int_pair<const char, std::uint16_t, segment>;
+    using view_type = strong_immutable_string_impl;
+    using size_type = std::size_t;
+
+private:
+
+    using header = detail::shared_pool_header;
+    using record = detail::shared_pool_record;
+
+    char* m_base = nullptr;
+    size_type m_size = 0;
+
+    inline header &head() const noexcept {
+        return *reinterpret_cast<header*>(m_base);
+    }
+
+    inline std::atomic<std::uint64_t>* buckets() const noexcept {
+        return reinterpret_cast<std::atomic<std::uint64_t>*>(m_base + sizeof(header));
+    }
+
+    inline const record &record_at(std::uint64_t offset) const noexcept {
+        return *reinterpret_cast<const record*>(m_base + offset);
+    }
+
+    inline handle handle_of(const record &r) const noexcept {
+        return handle{ r.data, r.size };
+    }
+
+    static inline std::uint64_t record_bytes(std::size_t len) noexcept {
+        return (detail::shared_pool_record_overhead + len + 7) & ~std::uint64_t(7);
+    }
+
+    static void initialize(char* base, size_type size) {
+        std::uint64_t buckets = 1024;
+        while (buckets * detail::shared_pool_bytes_per_bucket < size / 2) buckets <<= 1;
+
+        auto data_begin = sizeof(header) + buckets * sizeof(std::uint64_t);
+        if (data_begin >= size) throw std::length_error{ "Shared string pool segment too small" };
+
+        // A fresh segment is zero filled, which is an empty bucket table.
+        auto h = new (base) header;
+        h->size = size;
+        h->bucket_count = buckets;
+        h->data_begin = data_begin;
+        h->used.store(data_begin, std::memory_order_relaxed);
+        h->count.store(0, std::memory_order_relaxed);
+        h->ready.store(header::ready_magic, std::memory_order_release);
+    }
+
+    // Claims room for a record of len bytes, or returns 0 if the segment
+    // is full.
+    std::uint64_t allocate(const char* str, std::size_t len, std::uint64_t hash) {
+        auto bytes = record_bytes(len);
+        auto offset = head().used.fetch_add(bytes, std::memory_order_relaxed);
+        if (offset + bytes > m_size) return 0;
+
+        auto r = reinterpret_cast<record*>(m_base + offset);
+        r->hash = hash;
+        r->size = static_cast<std::uint16_t>(len);
+        std::memcpy(r->data, str, len);
+        r->data[len] = '\0';
+        return offset;
+    }
+
+    basic_shared_string_pool(char* base, size_type size) noexcept
+    :m_base{ base }, m_size{ size }
+    {
+        ASSERT(mapping() == nullptr);
+        mapping() = base;
+    }
+
+public:
+
+    // Opens the segment called name, creating it with size bytes if it
+    // doesn't exist yet. Processes that open an existing segment wait up to
+    // timeout for its creator to finish setting it up, and size is ignored.
+    // A creator that died halfway leaves a segment that never becomes ready;
+    // opening it throws std::system_error with ETIMEDOUT, and unlink() clears
+    // it.
+    static basic_shared_string_pool open(const char* name, size_type size,
+                                         std::chrono::milliseconds timeout = std::chrono::seconds{ 5 }) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        bool created = true;
+        int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            created = false;
+            fd = ::shm_open(name, O_RDWR, 0600);
+        }
+        if (fd < 0) throw std::system_error{ errno, std::generic_category(), "shm_open" };
+
+        struct stat st;
+        if (created) {
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                auto error = errno;
+                ::close(fd);
+                ::shm_unlink(name);
+                throw std::system_error{ error, std::generic_category(), "ftruncate" };
+            }
+        }
+        else {
+            for (;;) {
+                if (::fstat(fd, &st) != 0) {
+                    auto error = errno;
+                    ::close(fd);
+                    throw std::system_error{ error, std::generic_category(), "fstat" };
+                }
+                if (st.st_size > 0) break;
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    ::close(fd);
+                    throw std::system_error{ ETIMEDOUT, std::generic_category(), "shared string pool never sized" };
+                }
+                std::this_thread::yield();
+            }
+            size = static_cast<size_type>(st.st_size);
+        }
+
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        auto error = errno;
+        ::close(fd);
+        if (base == MAP_FAILED) throw std::system_error{ error, std::generic_category(), "mmap" };
+
+        auto bytes = static_cast<char*>(base);
+        if (created) {
+            try {
+                initialize(bytes, size);
+            }
+            catch (...) {
+                ::munmap(base, size);
+                ::shm_unlink(name);
+                throw;
+            }
+        }
+        else {
+            auto h = reinterpret_cast<header*>(bytes);
+            while (h->ready.load(std::memory_order_acquire) != header::ready_magic) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    ::munmap(base, size);
+                    throw std::system_error{ ETIMEDOUT, std::generic_category(), "shared string pool never ready" };
+                }
+                std::this_thread::yield();
+            }
+        }
+        return basic_shared_string_pool{ bytes, size };
+    }
+
+    // Removes the name; mappings that are still open stay valid.
+    static void unlink(const char* name) noexcept {
+        ::shm_unlink(name);
+    }
+
+    basic_shared_string_pool(const basic_shared_string_pool&) = delete;
+    basic_shared_string_pool &operator=(const basic_shared_string_pool&) = delete;
+
+    basic_shared_string_pool(basic_shared_string_pool &&other) noexcept
+    :m_base{ other.m_base }, m_size{ other.m_size }
+    {
+        other.m_base = nullptr;
+        other.m_size = 0;
+    }
+
+    basic_shared_string_pool &operator=(basic_shared_string_pool&&) = delete;
+
+    ~basic_shared_string_pool() {
+        if (m_base != nullptr) {
+            ::munmap(m_base, m_size);
+            mapping() = nullptr;
+        }
+    }
+
+    // Number of distinct strings in the pool, across all processes.
+    inline size_type size() const noexcept {
+        return head().count.load(std::memory_order_relaxed);
+    }
+
+    inline size_type bytes_used() const noexcept {
+        auto used = head().used.load(std::memory_order_relaxed);
+        return used < m_size ? used : m_size;
+    }
+
+    // The handle of the pooled copy of str, adding it if no process has yet.
+    // Throws std::bad_alloc when the segment or its table is full.
+    handle intern(const char* str, std::size_t len) {
+        ASSERT(len <= view_type::max_size());
+        auto hash = static_cast<std::uint64_t>(detail::immutable_string_hash(str, len));
+        auto mask = head().bucket_count - 1;
+        std::uint64_t mine = 0;
+
+        for (std::uint64_t probe = 0, i = hash & mask; probe <= mask; ++probe, i = (i + 1) & mask) {
+            auto &bucket = buckets()[i];
+            auto offset = bucket.load(std::memory_order_acquire);
+
+            if (offset == 0) {
+                if (mine == 0) {
+                    mine = allocate(str, len, hash);
+                    if (mine == 0) throw std::bad_alloc{};
+                }
+                if (bucket.compare_exchange_strong(offset, mine, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    head().count.fetch_add(1, std::memory_order_relaxed);
+                    return handle_of(record_at(mine));
+                }
+                // Lost the bucket; offset is the record that won it. If it
+                // holds some other string, mine goes in a later bucket.
+            }
+
+            auto &r = record_at(offset);
+            if (r.hash == hash && r.size == len && std::memcmp(r.data, str, len) == 0) {
+                return handle_of(r);
+            }
+        }
+        throw std::bad_alloc{};
+    }
+
+    template <typename Key, typename = std::enable_if_t<::is_comparable_as_immutable_strings<Key, strong_immutable_string_impl>::value>>
+    inline handle intern(const Key &key) {
+        return intern(key.data(), key.size());
+    }
+
+    inline view_type resolve(handle h) const noexcept {
+        return view_type{ h.pointer(), h.integer() };
+    }
+};
+
+using shared_string_pool = basic_shared_string_pool<void>;
@@ -0,0 +1,147 @@
+#include "test.h"
+#include "shared_string_pool.h"
+#include "comparators.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    struct first_mapping {};
+    struct second_mapping {};
+    struct child_mapping {};
+
+    const char* const pool_name = "/shared_string_pool_test";
+
+    std::string word(int i) {
+        return "reference string " + std::to_string(i);
+    }
+
+}
+
+TEST_CASE("shared string pool") {
+    basic_shared_string_pool<first_mapping>::unlink(pool_name);
+    auto pool = basic_shared_string_pool<first_mapping>::open(pool_name, 1 << 20);
+
+    GIVEN("strings interned twice") {
+        auto a = pool.intern(weak_immutable_string{ "hello" });
+        auto b = pool.intern(weak_immutable_string{ "hello" });
+        auto c = pool.intern(weak_immutable_string{ "world" });
+        auto empty = pool.intern(weak_immutable_string{ "" });
+
+        CHECK(a == b);
+        CHECK(a != c);
+        CHECK(pool.size() == 3);
+        CHECK(string_compare_pendatic::eq(pool.resolve(a), weak_immutable_string{ "hello" }));
+        CHECK(pool.resolve(a).c_str()[5] == '\0');
+        CHECK(pool.resolve(empty).empty());
+    }
+
+    GIVEN("a second mapping of the same segment") {
+        auto other = basic_shared_string_pool<second_mapping>::open(pool_name, 0);
+
+        auto a = pool.intern(weak_immutable_string{ "shared" });
+        auto b = other.intern(weak_immutable_string{ "shared" });
+
+        CHECK(a.offset() == b.offset());
+        CHECK(pool.resolve(a).data() != other.resolve(b).data());
+        CHECK(string_compare_pendatic::eq(other.resolve(b), weak_immutable_string{ "shared" }));
+    }
+
+    GIVEN("threads interning the same strings") {
+        auto before = pool.size();
+        std::vector<std::thread> threads;
+        std::vector<std::vector<std::int64_t>> offsets(4);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 2000; ++i) {
+                    auto w = word((i * (t + 1)) % 2000);
+                    offsets[t].push_back(pool.intern(w.c_str(), w.size()).offset());
+                }
+            });
+        }
+        for (auto &t : threads) t.join();
+
+        CHECK(pool.size() == before + 2000);
+        bool consistent = true;
+        for (int i = 0; i < 2000; ++i) {
+            auto w = word(i);
+            auto h = pool.intern(w.c_str(), w.size());
+            consistent = consistent && string_compare_pendatic::eq(pool.resolve(h), weak_immutable_string{ w });
+        }
+        CHECK(consistent);
+        CHECK(pool.size() == before + 2000);
+    }
+
+    GIVEN("another process") {
+        auto known = pool.intern(weak_immutable_string{ "from parent" });
+        auto before = pool.size();
+
+        auto pid = ::fork();
+        REQUIRE(pid >= 0);
+        if (pid == 0) {
+            auto child = basic_shared_string_pool<child_mapping>::open(pool_name, 0);
+            bool ok = child.intern(weak_immutable_string{ "from parent" }).offset() == known.offset();
+            child.intern(weak_immutable_string{ "from child" });
+            ::_exit(ok ? 0 : 1);
+        }
+
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 0);
+        CHECK(pool.size() == before + 1);
+        pool.intern(weak_immutable_string{ "from child" });
+        CHECK(pool.size() == before + 1);
+    }
+
+    GIVEN("a full segment") {
+        basic_shared_string_pool<second_mapping>::unlink("/shared_string_pool_test_small");
+        auto small = basic_shared_string_pool<second_mapping>::open("/shared_string_pool_test_small", 16 << 10);
+        basic_shared_string_pool<second_mapping>::unlink("/shared_string_pool_test_small");
+
+        bool threw = false;
+        try {
+            for (int i = 0; i < 100000; ++i) {
+                auto w = word(i);
+                small.intern(w.c_str(), w.size());
+            }
+        }
+        catch (const std::bad_alloc&) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    GIVEN("a segment whose creator died before setting it up") {
+        const char* name = "/shared_string_pool_test_abandoned";
+        basic_shared_string_pool<second_mapping>::unlink(name);
+        int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        REQUIRE(fd >= 0);
+
+        auto open_errno = [name] {
+            try {
+                basic_shared_string_pool<second_mapping>::open(name, 0, std::chrono::milliseconds{ 50 });
+            }
+            catch (const std::system_error &e) {
+                return e.code().value();
+            }
+            return 0;
+        };
+
+        CHECK(open_errno() == ETIMEDOUT);
+        REQUIRE(::ftruncate(fd, 16 << 10) == 0);
+        CHECK(open_errno() == ETIMEDOUT);
+
+        ::close(fd);
+        basic_shared_string_pool<second_mapping>::unlink(name);
+    }
+
+    basic_shared_string_pool<first_mapping>::unlink(pool_name);
+}
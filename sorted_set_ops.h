@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "parallel.h"
+#include "ptr_int_pair_48va.h"
+#include "tag_scan.h"
+
+// Set algebra over arrays of ptr_int_pair_48va sorted by opaque_lt. The set
+// operations expect inputs without duplicates; merge accepts any sorted
+// input and keeps duplicates. out needs room for the largest possible
+// result and must not overlap the inputs.
+//
+// When one input is much smaller than the other, each of its elements is
+// located in the larger one with a galloping search. Otherwise intersection
+// and difference compare blocks of four against four under AVX2, and union
+// and merge run a branch free scalar loop. Large inputs are split into
+// chunks of matching values and processed on several threads.
+
+namespace detail {
+
+    static constexpr std::size_t set_op_min_chunk = 1 << 16;
+    static constexpr std::size_t gallop_ratio = 32;
+
+    // First element in [first, last) whose raw word is >= key (or > key if
+    // Upper), probing at doubling distances before a binary search.
+    template <bool Upper, typename Pair>
+    const Pair* gallop(const Pair* first, const Pair* last, std::uint64_t key) {
+        auto before = [key](const Pair &p) { return Upper ? p.raw() <= key : p.raw() < key; };
+
+        std::size_t n = static_cast<std::size_t>(last - first);
+        if (n == 0 || !before(first[0])) return first;
+
+        std::size_t bound = 1;
+        while (bound < n && before(first[bound])) bound *= 2;
+
+        return std::partition_point(first + bound / 2 + 1, first + std::min(bound, n), before);
+    }
+
+    // Intersection (Intersect) or difference of two ranges of similar size.
+    template <bool Intersect, typename Pair>
+    Pair* intersect_or_subtract(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out) {
+#if defined(__AVX2__)
+        const auto &tables = compress4();
+        unsigned found = 0;
+
+        while (a_last - a >= 4 && b_last - b >= 4) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+            __m256i eq = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi64(va, vb),
+                                                         _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                                         _mm256_or_si256(_mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                                                         _mm256_cmpeq_epi64(va, _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+            found |= static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+
+            auto a_max = a[3].raw();
+            auto b_max = b[3].raw();
+
+            // The block of a is done once b has caught up with it.
+            if (a_max <= b_max) {
+                unsigned m = Intersect ? found : found ^ 0xf;
+                __m256i v = _mm256_permutevar8x32_epi32(va, _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.permute[m])));
+                _mm256_maskstore_epi64(reinterpret_cast<long long*>(out), _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.store[popcount8(m)])), v);
+                out += popcount8(m);
+                found = 0;
+                a += 4;
+            }
+            if (b_max <= a_max) {
+                b += 4;
+            }
+        }
+
+        // Finish a partly matched block; its matches were in blocks of b
+        // that have already been consumed.
+        if (found) {
+            for (unsigned lane = 0; lane < 4; ++lane, ++a) {
+                if (found & (1u << lane)) {
+                    if (Intersect) *out++ = *a;
+                    continue;
+                }
+                while (b != b_last && b->raw() < a->raw()) ++b;
+                if ((b != b_last && b->raw() == a->raw()) == Intersect) *out++ = *a;
+            }
+        }
+#endif
+
+        while (a != a_last && b != b_last) {
+            auto x = a->raw();
+            auto y = b->raw();
+            if (Intersect ? x == y : x < y) *out++ = *a;
+            a += x <= y;
+            b += y <= x;
+        }
+        return Intersect ? out : std::copy(a, a_last, out);
+    }
+
+    struct intersection_op {
+        static std::size_t max_output(std::size_t na, std::size_t nb) {
+            return std::min(na, nb);
+        }
+
+        template <typename Pair>
+        static Pair* apply(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out) {
+            std::size_t na = static_cast<std::size_t>(a_last - a), nb = static_cast<std::size_t>(b_last - b);
+            if (nb < na) {
+                std::swap(a, b);
+                std::swap(a_last, b_last);
+                std::swap(na, nb);
+            }
+
+            if (na * gallop_ratio < nb) {
+                for (; a != a_last && b != b_last; ++a) {
+                    b = gallop<false>(b, b_last, a->raw());
+                    if (b != b_last && b->raw() == a->raw()) *out++ = *a;
+                }
+                return out;
+            }
+            return intersect_or_subtract<true>(a, a_last, b, b_last, out);
+        }
+    };
+
+    struct difference_op {
+        static std::size_t max_output(std::size_t na, std::size_t) {
+            return na;
+        }
+
+        template <typename Pair>
+        static Pair* apply(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out) {
+            std::size_t na = static_cast<std::size_t>(a_last - a), nb = static_cast<std::size_t>(b_last - b);
+
+            if (na * gallop_ratio < nb) {
+                for (; a != a_last; ++a) {
+                    b = gallop<false>(b, b_last, a->raw());
+                    if (b == b_last || b->raw() != a->raw()) *out++ = *a;
+                }
+                return out;
+            }
+            if (nb * gallop_ratio < na) {
+                for (; b != b_last; ++b) {
+                    auto p = gallop<false>(a, a_last, b->raw());
+                    out = std::copy(a, p, out);
+                    a = p != a_last && p->raw() == b->raw() ? p + 1 : p;
+                }
+                return std::copy(a, a_last, out);
+            }
+            return intersect_or_subtract<false>(a, a_last, b, b_last, out);
+        }
+    };
+
+    struct union_op {
+        static std::size_t max_output(std::size_t na, std::size_t nb) {
+            return na + nb;
+        }
+
+        template <typename Pair>
+        static Pair* apply(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out) {
+            std::size_t na = static_cast<std::size_t>(a_last - a), nb = static_cast<std::size_t>(b_last - b);
+            if (na < nb) {
+                std::swap(a, b);
+                std::swap(a_last, b_last);
+                std::swap(na, nb);
+            }
+
+            if (nb * gallop_ratio < na) {
+                for (; b != b_last; ++b) {
+                    auto p = gallop<false>(a, a_last, b->raw());
+                    out = std::copy(a, p, out);
+                    *out++ = *b;
+                    a = p != a_last && p->raw() == b->raw() ? p + 1 : p;
+                }
+                return std::copy(a, a_last, out);
+            }
+
+            while (a != a_last && b != b_last) {
+                auto x = a->raw();
+                auto y = b->raw();
+                *out++ = y < x ? *b : *a;
+                a += x <= y;
+                b += y <= x;
+            }
+            return std::copy(b, b_last, std::copy(a, a_last, out));
+        }
+    };
+
+    struct merge_op {
+        static std::size_t max_output(std::size_t na, std::size_t nb) {
+            return na + nb;
+        }
+
+        template <typename Pair>
+        static Pair* apply(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out) {
+            std::size_t na = static_cast<std::size_t>(a_last - a), nb = static_cast<std::size_t>(b_last - b);
+
+            if (nb * gallop_ratio < na) {
+                for (; b != b_last; ++b) {
+                    auto p = gallop<true>(a, a_last, b->raw());
+                    out = std::copy(a, p, out);
+                    *out++ = *b;
+                    a = p;
+                }
+                return std::copy(a, a_last, out);
+            }
+            if (na * gallop_ratio < nb) {
+                for (; a != a_last; ++a) {
+                    auto p = gallop<false>(b, b_last, a->raw());
+                    out = std::copy(b, p, out);
+                    *out++ = *a;
+                    b = p;
+                }
+                return std::copy(b, b_last, out);
+            }
+
+            while (a != a_last && b != b_last) {
+                bool take_b = b->raw() < a->raw();
+                *out++ = take_b ? *b : *a;
+                a += !take_b;
+                b += take_b;
+            }
+            return std::copy(b, b_last, std::copy(a, a_last, out));
+        }
+    };
+
+    // Splits the larger input into equal chunks and the other one at the
+    // matching values, runs Op on every pair of chunks into a private buffer
+    // and then concatenates the buffers into out.
+    template <typename Op, typename Pair>
+    Pair* run_set_op(const Pair* a, const Pair* a_last, const Pair* b, const Pair* b_last, Pair* out, std::size_t threads) {
+        std::size_t na = static_cast<std::size_t>(a_last - a), nb = static_cast<std::size_t>(b_last - b);
+        threads = worker_count(threads, na + nb, set_op_min_chunk);
+        if (threads == 1) {
+            return Op::apply(a, a_last, b, b_last, out);
+        }
+
+        // Equal values always land in the chunk that starts with them.
+        std::vector<const Pair*> a_bounds(threads + 1), b_bounds(threads + 1);
+        for (std::size_t t = 0; t <= threads; ++t) {
+            if (na >= nb) {
+                a_bounds[t] = a + na * t / threads;
+                b_bounds[t] = t == 0 ? b : t == threads ? b_last : gallop<false>(b_bounds[t - 1], b_last, a_bounds[t]->raw());
+            }
+            else {
+                b_bounds[t] = b + nb * t / threads;
+                a_bounds[t] = t == 0 ? a : t == threads ? a_last : gallop<false>(a_bounds[t - 1], a_last, b_bounds[t]->raw());
+            }
+        }
+
+        std::vector<std::vector<Pair>> parts(threads);
+        run_on_threads(threads, [&](std::size_t t) {
+            auto &part = parts[t];
+            part.resize(Op::max_output(static_cast<std::size_t>(a_bounds[t + 1] - a_bounds[t]),
+                                       static_cast<std::size_t>(b_bounds[t + 1] - b_bounds[t])));
+            auto end = Op::apply(a_bounds[t], a_bounds[t + 1], b_bounds[t], b_bounds[t + 1], part.data());
+            part.resize(static_cast<std::size_t>(end - part.data()));
+        });
+
+        std::vector<Pair*> destinations(threads + 1);
+        destinations[0] = out;
+        for (std::size_t t = 0; t < threads; ++t) {
+            destinations[t + 1] = destinations[t] + parts[t].size();
+        }
+        run_on_threads(threads, [&](std::size_t t) {
+            std::copy(parts[t].begin(), parts[t].end(), destinations[t]);
+        });
+        return destinations[threads];
+    }
+
+}
+
+// Each operation returns the end of the output. threads == 0 uses every
+// hardware thread; small inputs always run on the calling thread.
+
+template <typename PtrType, typename IntType>
+ptr_int_pair_48va<PtrType, IntType>* set_intersection_opaque(const ptr_int_pair_48va<PtrType, IntType>* a_first, const ptr_int_pair_48va<PtrType, IntType>* a_last,
+                                                             const ptr_int_pair_48va<PtrType, IntType>* b_first, const ptr_int_pair_48va<PtrType, IntType>* b_last,
+                                                             ptr_int_pair_48va<PtrType, IntType>* out, std::size_t threads = 0)
+{
+    return detail::run_set_op<detail::intersection_op>(a_first, a_last, b_first, b_last, out, threads);
+}
+
+template <typename PtrType, typename IntType>
+ptr_int_pair_48va<PtrType, IntType>* set_difference_opaque(const ptr_int_pair_48va<PtrType, IntType>* a_first, const ptr_int_pair_48va<PtrType, IntType>* a_last,
+                                                           const ptr_int_pair_48va<PtrType, IntType>* b_first, const ptr_int_pair_48va<PtrType, IntType>* b_last,
+                                                           ptr_int_pair_48va<PtrType, IntType>* out, std::size_t threads = 0)
+{
+    return detail::run_set_op<detail::difference_op>(a_first, a_last, b_first, b_last, out, threads);
+}
+
+template <typename PtrType, typename IntType>
+ptr_int_pair_48va<PtrType, IntType>* set_union_opaque(const ptr_int_pair_48va<PtrType, IntType>* a_first, const ptr_int_pair_48va<PtrType, IntType>* a_last,
+                                                      const ptr_int_pair_48va<PtrType, IntType>* b_first, const ptr_int_pair_48va<PtrType, IntType>* b_last,
+                                                      ptr_int_pair_48va<PtrType, IntType>* out, std::size_t threads = 0)
+{
+    return detail::run_set_op<detail::union_op>(a_first, a_last, b_first, b_last, out, threads);
+}
+
+template <typename PtrType, typename IntType>
+ptr_int_pair_48va<PtrType, IntType>* merge_opaque(const ptr_int_pair_48va<PtrType, IntType>* a_first, const ptr_int_pair_48va<PtrType, IntType>* a_last,
+                                                  const ptr_int_pair_48va<PtrType, IntType>* b_first, const ptr_int_pair_48va<PtrType, IntType>* b_last,
+                                                  ptr_int_pair_48va<PtrType, IntType>* out, std::size_t threads = 0)
+{
+    return detail::run_set_op<detail::merge_op>(a_first, a_last, b_first, b_last, out, threads);
+}
@@ -0,0 +1,79 @@
+#include "test.h"
+#include "sorted_set_ops.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+
+    using pair_type = ptr_int_pair_48va<int, short>;
+
+    std::vector<pair_type> random_set(std::size_t count, std::vector<int> &storage, std::mt19937_64 &rng) {
+        std::uniform_int_distribution<std::size_t> ptr{ 0, storage.size() - 1 };
+        std::uniform_int_distribution<int> integer{ -4, 4 };
+
+        std::vector<pair_type> set;
+        for (std::size_t i = 0; i < count; ++i) {
+            set.emplace_back(&storage[ptr(rng)], static_cast<short>(integer(rng)));
+        }
+        std::sort(set.begin(), set.end(), pair_type::opaque_comparator{});
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+        return set;
+    }
+
+    template <typename F>
+    std::vector<pair_type> run(F f, const std::vector<pair_type> &a, const std::vector<pair_type> &b, std::size_t threads) {
+        std::vector<pair_type> out(a.size() + b.size());
+        auto end = f(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), out.data(), threads);
+        out.resize(static_cast<std::size_t>(end - out.data()));
+        return out;
+    }
+
+}
+
+TEST_CASE("sorted set operations") {
+    std::vector<int> storage(20000);
+    std::mt19937_64 rng{ 5 };
+
+    const std::size_t sizes[][2] = { { 0, 0 }, { 0, 100 }, { 7, 5 }, { 1000, 1000 }, { 30, 50000 }, { 50000, 30 }, { 150000, 120000 } };
+
+    for (auto size : sizes) {
+        auto a = random_set(size[0], storage, rng);
+        auto b = random_set(size[1], storage, rng);
+        pair_type::opaque_comparator less;
+
+        std::vector<pair_type> intersection, difference, unite, merged;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(intersection), less);
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(difference), less);
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(unite), less);
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged), less);
+
+        for (std::size_t threads : { 1, 3 }) {
+            CHECK(run(set_intersection_opaque<int, short>, a, b, threads) == intersection);
+            CHECK(run(set_difference_opaque<int, short>, a, b, threads) == difference);
+            CHECK(run(set_union_opaque<int, short>, a, b, threads) == unite);
+            CHECK(run(merge_opaque<int, short>, a, b, threads) == merged);
+        }
+    }
+}
+
+TEST_CASE("merge with duplicates") {
+    int values[3] = {};
+
+    std::vector<pair_type> a, b;
+    for (int i = 0; i < 200000; ++i) {
+        a.emplace_back(&values[i % 3], static_cast<short>(i % 5));
+        b.emplace_back(&values[(i + 1) % 3], static_cast<short>(i % 7));
+    }
+    std::sort(a.begin(), a.end(), pair_type::opaque_comparator{});
+    std::sort(b.begin(), b.end(), pair_type::opaque_comparator{});
+
+    std::vector<pair_type> expected;
+    std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected), pair_type::opaque_comparator{});
+
+    for (std::size_t threads : { 1, 4 }) {
+        CHECK(run(merge_opaque<int, short>, a, b, threads) == expected);
+    }
+}
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "immutable_string.h"
+
+// Bounded lock-free queues that hand weak_immutable_string ownership from
+// one thread to another. Each slot is the string's own 8 byte buffer word:
+// a push takes it out of the string with release_buffer() and a pop adopts
+// it into a new string, so no message allocates or copies.
+//
+// The WaitPolicy decides what the blocking push() and pop() do when the
+// queue is full or empty: channel_busy_poll spins, channel_futex_wait sleeps
+// in the kernel (where available) and costs a syscall on the other side
+// only while someone is actually asleep. The try_ and batch calls never
+// block under either policy.
+
+class channel_busy_poll {
+
+public:
+
+    inline std::uint32_t prepare_wait() noexcept {
+        return 0;
+    }
+
+    inline void cancel_wait() noexcept {}
+
+    inline void wait(std::uint32_t) noexcept {
+        std::this_thread::yield();
+    }
+
+    inline void notify() noexcept {}
+};
+
+class channel_futex_wait {
+
+    std::atomic<std::uint32_t> m_sequence{ 0 };
+    std::atomic<std::uint32_t> m_waiters{ 0 };
+
+public:
+
+    // Registers as a waiter; the caller must check its condition again
+    // before calling wait() with the returned key, or cancel_wait().
+    inline std::uint32_t prepare_wait() noexcept {
+        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+        return m_sequence.load(std::memory_order_seq_cst);
+    }
+
+    inline void cancel_wait() noexcept {
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Returns once notify() has been called since prepare_wait(), or
+    // spuriously.
+    inline void wait(std::uint32_t key) noexcept {
+#if defined(__linux__)
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&m_sequence), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+#else
+        if (m_sequence.load(std::memory_order_seq_cst) == key) std::this_thread::yield();
+#endif
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    inline void notify() noexcept {
+        m_sequence.fetch_add(1, std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_seq_cst) != 0) {
+#if defined(__linux__)
+            ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&m_sequence), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+    }
+};
+
+namespace detail {
+
+    static constexpr std::size_t channel_line = 64;
+
+    inline std::size_t channel_capacity(std::size_t n) noexcept {
+        std::size_t capacity = 2;
+        while (capacity < n) capacity <<= 1;
+        return capacity;
+    }
+
+    inline std::uint64_t take_word(weak_immutable_string &str) noexcept {
+        return str.release_buffer().raw();
+    }
+
+    inline weak_immutable_string adopt_word(std::uint64_t word) noexcept {
+        return weak_immutable_string{ adopt_buffer, weak_immutable_string::buffer_type::from_raw(word) };
+    }
+
+    // Blocking loop shared by both channels: retries op until it succeeds,
+    // sleeping on event in between.
+    template <typename Event, typename Op>
+    inline void wait_until(Event &event, Op &&op) {
+        while (!op()) {
+            auto key = event.prepare_wait();
+            if (op()) {
+                event.cancel_wait();
+                return;
+            }
+            event.wait(key);
+        }
+    }
+
+}
+
+// One producer thread, one consumer thread.
+template <typename WaitPolicy = channel_busy_poll>
+class spsc_string_channel {
+
+    const std::size_t m_mask;
+    std::unique_ptr<std::uint64_t[]> m_slots;
+
+    alignas(detail::channel_line) std::atomic<std::size_t> m_tail{ 0 };
+    std::size_t m_head_cache = 0;
+    WaitPolicy m_not_empty;
+
+    alignas(detail::channel_line) std::atomic<std::size_t> m_head{ 0 };
+    std::size_t m_tail_cache = 0;
+    WaitPolicy m_not_full;
+
+public:
+
+    // Holds at least capacity strings, rounded up to a power of two.
+    explicit spsc_string_channel(std::size_t capacity)
+    :m_mask{ detail::channel_capacity(capacity) - 1 }, m_slots{ new std::uint64_t[m_mask + 1] }
+    {}
+
+    spsc_string_channel(const spsc_string_channel&) = delete;
+    spsc_string_channel &operator=(const spsc_string_channel&) = delete;
+
+    ~spsc_string_channel() {
+        for (auto i = m_head.load(std::memory_order_relaxed); i != m_tail.load(std::memory_order_relaxed); ++i) {
+            detail::adopt_word(m_slots[i & m_mask]);
+        }
+    }
+
+    inline std::size_t capacity() const noexcept {
+        return m_mask + 1;
+    }
+
+    // Moves up to n strings from first into the channel, in order, and
+    // returns how many went in. The ones that did are left empty.
+    std::size_t push_n(weak_immutable_string* first, std::size_t n) noexcept {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache + n > capacity()) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        }
+
+        auto room = capacity() - (tail - m_head_cache);
+        if (n > room) n = room;
+        if (n == 0) return 0;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            m_slots[(tail + i) & m_mask] = detail::take_word(first[i]);
+        }
+        m_tail.store(tail + n, std::memory_order_release);
+        m_not_empty.notify();
+        return n;
+    }
+
+    // Moves up to n strings out of the channel into out and returns how
+    // many there were.
+    std::size_t pop_n(weak_immutable_string* out, std::size_t n) noexcept {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (m_tail_cache - head < n) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+        }
+
+        auto available = m_tail_cache - head;
+        if (n > available) n = available;
+        if (n == 0) return 0;
+
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = detail::adopt_word(m_slots[(head + i) & m_mask]);
+        }
+        m_head.store(head + n, std::memory_order_release);
+        m_not_full.notify();
+        return n;
+    }
+
+    // On failure str keeps its value.
+    inline bool try_push(weak_immutable_string &&str) noexcept {
+        return push_n(&str, 1) == 1;
+    }
+
+    inline bool try_pop(weak_immutable_string &out) noexcept {
+        return pop_n(&out, 1) == 1;
+    }
+
+    void push(weak_immutable_string &&str) {
+        detail::wait_until(m_not_full, [&] { return try_push(std::move(str)); });
+    }
+
+    weak_immutable_string pop() {
+        weak_immutable_string out;
+        detail::wait_until(m_not_empty, [&] { return try_pop(out); });
+        return out;
+    }
+};
+
+// Any number of producer threads, one consumer thread. An empty slot holds
+// 0, which is never the word of a string since even empty strings point at
+// their static terminator.
+template <typename WaitPolicy = channel_busy_poll>
+class mpsc_string_channel {
+
+    const std::size_t m_mask;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_slots;
+
+    alignas(detail::channel_line) std::atomic<std::size_t> m_tail{ 0 };
+    WaitPolicy m_not_empty;
+
+    alignas(detail::channel_line) std::atomic<std::size_t> m_head{ 0 };
+    WaitPolicy m_not_full;
+
+public:
+
+    explicit mpsc_string_channel(std::size_t capacity)
+    :m_mask{ detail::channel_capacity(capacity) - 1 }, m_slots{ new std::atomic<std::uint64_t>[m_mask + 1] }
+    {
+        for (std::size_t i = 0; i <= m_mask; ++i) {
+            m_slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_string_channel(const mpsc_string_channel&) = delete;
+    mpsc_string_channel &operator=(const mpsc_string_channel&) = delete;
+
+    ~mpsc_string_channel() {
+        for (std::size_t i = 0; i <= m_mask; ++i) {
+            auto word = m_slots[i].load(std::memory_order_relaxed);
+            if (word != 0) detail::adopt_word(word);
+        }
+    }
+
+    inline std::size_t capacity() const noexcept {
+        return m_mask + 1;
+    }
+
+    // Claims room for up to n strings in one step, so a batch stays
+    // contiguous and in order even with other producers running.
+    std::size_t push_n(weak_immutable_string* first, std::size_t n) noexcept {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        std::size_t claimed;
+        do {
+            auto room = capacity() - (tail - m_head.load(std::memory_order_acquire));
+            claimed = n < room ? n : room;
+            if (claimed == 0) return 0;
+        } while (!m_tail.compare_exchange_weak(tail, tail + claimed, std::memory_order_relaxed));
+
+        for (std::size_t i = 0; i < claimed; ++i) {
+            m_slots[(tail + i) & m_mask].store(detail::take_word(first[i]), std::memory_order_release);
+        }
+        m_not_empty.notify();
+        return claimed;
+    }
+
+    // Stops early at a slot that has been claimed but not yet filled.
+    std::size_t pop_n(weak_immutable_string* out, std::size_t n) noexcept {
+        auto head = m_head.load(std::memory_order_relaxed);
+        std::size_t count = 0;
+        for (; count < n; ++count) {
+            auto &slot = m_slots[(head + count) & m_mask];
+            auto word = slot.load(std::memory_order_acquire);
+            if (word == 0) break;
+            slot.store(0, std::memory_order_relaxed);
+            out[count] = detail::adopt_word(word);
+        }
+        if (count == 0) return 0;
+
+        m_head.store(head + count, std::memory_order_release);
+        m_not_full.notify();
+        return count;
+    }
+
+    inline bool try_push(weak_immutable_string &&str) noexcept {
+        return push_n(&str, 1) == 1;
+    }
+
+    inline bool try_pop(weak_immutable_string &out) noexcept {
+        return pop_n(&out, 1) == 1;
+    }
+
+    void push(weak_immutable_string &&str) {
+        detail::wait_until(m_not_full, [&] { return try_push(std::move(str)); });
+    }
+
+    weak_immutable_string pop() {
+        weak_immutable_string out;
+        detail::wait_until(m_not_empty, [&] { return try_pop(out); });
+        return out;
+    }
+};
@@ -0,0 +1,115 @@
+#include "test.h"
+#include "string_channel.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    weak_immutable_string message(int producer, int i) {
+        return weak_immutable_string{ std::to_string(producer) + ":" + std::to_string(i) };
+    }
+
+    // Every producer's messages must arrive complete and in order.
+    template <typename Channel>
+    void run(Channel &channel, int producers, int per_producer) {
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < per_producer;) {
+                    if (i % 3 == 0) {
+                        weak_immutable_string batch[4] = { message(p, i), message(p, i + 1), message(p, i + 2), message(p, i + 3) };
+                        auto end = i + 4 <= per_producer ? 4 : per_producer - i;
+                        std::size_t pushed = 0;
+                        while (pushed < static_cast<std::size_t>(end)) {
+                            auto n = channel.push_n(batch + pushed, end - pushed);
+                            if (n == 0) std::this_thread::yield();
+                            pushed += n;
+                        }
+                        i += end;
+                    }
+                    else {
+                        channel.push(message(p, i));
+                        ++i;
+                    }
+                }
+            });
+        }
+
+        std::vector<int> next(producers, 0);
+        bool in_order = true;
+        weak_immutable_string batch[8];
+        for (int received = 0; received < producers * per_producer;) {
+            std::size_t n = 1;
+            if (received % 2 == 0) {
+                batch[0] = channel.pop();
+            }
+            else {
+                n = channel.pop_n(batch, 8);
+                if (n == 0) std::this_thread::yield();
+            }
+            for (std::size_t k = 0; k < n; ++k) {
+                std::string text{ batch[k].data(), batch[k].size() };
+                auto colon = text.find(':');
+                auto p = std::stoi(text.substr(0, colon));
+                auto i = std::stoi(text.substr(colon + 1));
+                in_order = in_order && next[p] == i;
+                next[p] = i + 1;
+            }
+            received += static_cast<int>(n);
+        }
+
+        for (auto &t : threads) t.join();
+        CHECK(in_order);
+        weak_immutable_string extra;
+        CHECK(!channel.try_pop(extra));
+    }
+
+}
+
+TEST_CASE("spsc string channel") {
+    GIVEN("a full channel") {
+        spsc_string_channel<> channel{ 3 };
+        CHECK(channel.capacity() == 4);
+        for (int i = 0; i < 4; ++i) CHECK(channel.try_push(message(0, i)));
+
+        auto rejected = message(0, 4);
+        CHECK(!channel.try_push(std::move(rejected)));
+        CHECK(rejected.size() == 3);
+
+        weak_immutable_string out;
+        CHECK(channel.try_pop(out));
+        CHECK(std::string{ out.data(), out.size() } == "0:0");
+        // The rest are freed by the destructor.
+    }
+
+    GIVEN("busy polling") {
+        spsc_string_channel<channel_busy_poll> channel{ 16 };
+        run(channel, 1, 20000);
+    }
+
+    GIVEN("futex waiting") {
+        spsc_string_channel<channel_futex_wait> channel{ 16 };
+        run(channel, 1, 20000);
+    }
+}
+
+TEST_CASE("mpsc string channel") {
+    GIVEN("busy polling") {
+        mpsc_string_channel<channel_busy_poll> channel{ 64 };
+        run(channel, 4, 5000);
+    }
+
+    GIVEN("futex waiting") {
+        mpsc_string_channel<channel_futex_wait> channel{ 8 };
+        run(channel, 4, 5000);
+    }
+
+    GIVEN("leftover messages") {
+        mpsc_string_channel<> channel{ 8 };
+        weak_immutable_string batch[3] = { message(1, 1), message(1, 2), weak_immutable_string{} };
+        CHECK(channel.push_n(batch, 3) == 3);
+        CHECK(batch[0].empty());
+    }
+}
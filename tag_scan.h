@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "ptr_int_pair_48va.h"
+
+// Scans over arrays of ptr_int_pair_48va that only look at the integer (the
+// tag), read straight out of the high bits of each raw word. Every kernel
+// takes an inclusive [lo, hi] range in IntType order; the single tag
+// overloads match one value. AVX-512 and AVX2 builds test eight or four
+// words per step, everything else falls back to a scalar loop over raw().
+
+namespace detail {
+
+    template <typename Pair>
+    struct tag_scan_traits;
+
+    template <typename PtrType, typename IntType>
+    struct tag_scan_traits<ptr_int_pair_48va<PtrType, IntType>> {
+        using int_type = IntType;
+
+        static constexpr int bits = 8 * sizeof(IntType);
+        static constexpr std::uint64_t mask = (std::uint64_t(1) << bits) - 1;
+        static constexpr std::uint64_t flip = std::is_signed<IntType>::value ? std::uint64_t(1) << (bits - 1) : 0;
+
+        // The tag bits of a raw word, reordered so that unsigned order
+        // matches IntType order.
+        static constexpr std::uint64_t ordered(std::uint64_t raw) {
+            return ((raw >> 48) & mask) ^ flip;
+        }
+
+        static constexpr std::uint64_t ordered_tag(IntType i) {
+            return (static_cast<std::uint64_t>(i) & mask) ^ flip;
+        }
+    };
+
+    template <typename Pair>
+    struct tag_scan_traits<const Pair> : tag_scan_traits<Pair> {};
+
+    template <typename Pair>
+    class tag_matcher {
+
+        using traits = tag_scan_traits<Pair>;
+
+        std::uint64_t m_lo;
+        std::uint64_t m_hi;
+
+    public:
+
+        constexpr tag_matcher(typename traits::int_type lo, typename traits::int_type hi)
+        :m_lo{ traits::ordered_tag(lo) }, m_hi{ traits::ordered_tag(hi) }
+        {}
+
+        constexpr bool operator()(const Pair &p) const {
+            return traits::ordered(p.raw()) >= m_lo && traits::ordered(p.raw()) <= m_hi;
+        }
+
+#if defined(__AVX512F__)
+        // Bit i set if word i of the eight at p matches.
+        inline __mmask8 match8(const Pair* p) const noexcept {
+            __m512i w = _mm512_loadu_si512(p);
+            __m512i t = _mm512_xor_si512(_mm512_and_si512(_mm512_srli_epi64(w, 48), _mm512_set1_epi64(static_cast<long long>(traits::mask))),
+                                         _mm512_set1_epi64(static_cast<long long>(traits::flip)));
+            return _mm512_cmp_epu64_mask(t, _mm512_set1_epi64(static_cast<long long>(m_lo)), _MM_CMPINT_NLT) &
+                   _mm512_cmp_epu64_mask(t, _mm512_set1_epi64(static_cast<long long>(m_hi)), _MM_CMPINT_LE);
+        }
+#endif
+
+#if defined(__AVX2__)
+        // All ones in each lane of the four at p that matches. Tags are at
+        // most 16 bits wide, so the signed compares are safe.
+        inline __m256i match4(const Pair* p) const noexcept {
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i t = _mm256_xor_si256(_mm256_and_si256(_mm256_srli_epi64(w, 48), _mm256_set1_epi64x(static_cast<long long>(traits::mask))),
+                                         _mm256_set1_epi64x(static_cast<long long>(traits::flip)));
+            __m256i below = _mm256_cmpgt_epi64(_mm256_set1_epi64x(static_cast<long long>(m_lo)), t);
+            __m256i above = _mm256_cmpgt_epi64(t, _mm256_set1_epi64x(static_cast<long long>(m_hi)));
+            return _mm256_xor_si256(_mm256_or_si256(below, above), _mm256_set1_epi64x(-1));
+        }
+#endif
+    };
+
+    inline unsigned popcount8(unsigned m) noexcept {
+        m = m - ((m >> 1) & 0x55);
+        m = (m & 0x33) + ((m >> 2) & 0x33);
+        return (m + (m >> 4)) & 0x0f;
+    }
+
+    inline unsigned lowest_bit8(unsigned m) noexcept {
+        unsigned i = 0;
+        while (!(m & 1)) {
+            m >>= 1;
+            ++i;
+        }
+        return i;
+    }
+
+#if defined(__AVX2__)
+    // permutevar8x32 indices that pack the 64 bit lanes selected by a four
+    // bit mask to the front, and maskstore masks for 0 to 4 leading lanes.
+    struct compress4_tables {
+        alignas(32) std::int32_t permute[16][8];
+        alignas(32) std::int64_t store[5][4];
+
+        compress4_tables() {
+            for (unsigned m = 0; m < 16; ++m) {
+                unsigned out = 0;
+                for (unsigned lane = 0; lane < 4; ++lane) {
+                    if (m & (1u << lane)) {
+                        permute[m][2 * out] = static_cast<std::int32_t>(2 * lane);
+                        permute[m][2 * out + 1] = static_cast<std::int32_t>(2 * lane + 1);
+                        ++out;
+                    }
+                }
+                for (; out < 4; ++out) {
+                    permute[m][2 * out] = 0;
+                    permute[m][2 * out + 1] = 1;
+                }
+            }
+            for (unsigned n = 0; n <= 4; ++n) {
+                for (unsigned lane = 0; lane < 4; ++lane) {
+                    store[n][lane] = lane < n ? -1 : 0;
+                }
+            }
+        }
+    };
+
+    inline const compress4_tables &compress4() {
+        static const compress4_tables tables;
+        return tables;
+    }
+#endif
+
+    // Copies the matching pairs of [first, last) to out, in order. out may
+    // alias first since it never gets ahead of the read position.
+    template <bool Match, typename Pair>
+    Pair* compress_by_tag(const Pair* first, const Pair* last, Pair* out, const tag_matcher<Pair> &match) {
+#if defined(__AVX512F__)
+        for (; last - first >= 8; first += 8) {
+            __mmask8 m = match.match8(first);
+            if (!Match) m = static_cast<__mmask8>(~m);
+            _mm512_mask_compressstoreu_epi64(out, m, _mm512_loadu_si512(first));
+            out += popcount8(m);
+        }
+#elif defined(__AVX2__)
+        const auto &tables = compress4();
+        for (; last - first >= 4; first += 4) {
+            unsigned m = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(match.match4(first))));
+            if (!Match) m ^= 0xf;
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            v = _mm256_permutevar8x32_epi32(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.permute[m])));
+            auto count = popcount8(m);
+            _mm256_maskstore_epi64(reinterpret_cast<long long*>(out), _mm256_load_si256(reinterpret_cast<const __m256i*>(tables.store[count])), v);
+            out += count;
+        }
+#endif
+        for (; first != last; ++first) {
+            if (match(*first) == Match) {
+                *out++ = *first;
+            }
+        }
+        return out;
+    }
+
+}
+
+template <typename Pair>
+std::size_t count_if_tag(const Pair* first, const Pair* last,
+                         typename detail::tag_scan_traits<Pair>::int_type lo,
+                         typename detail::tag_scan_traits<Pair>::int_type hi)
+{
+    detail::tag_matcher<Pair> match{ lo, hi };
+    std::size_t count = 0;
+
+#if defined(__AVX512F__)
+    for (; last - first >= 8; first += 8) {
+        count += detail::popcount8(match.match8(first));
+    }
+#elif defined(__AVX2__)
+    for (; last - first >= 4; first += 4) {
+        count += detail::popcount8(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(match.match4(first)))));
+    }
+#endif
+    for (; first != last; ++first) {
+        count += match(*first);
+    }
+    return count;
+}
+
+template <typename Pair>
+std::size_t count_if_tag(const Pair* first, const Pair* last, typename detail::tag_scan_traits<Pair>::int_type tag) {
+    return count_if_tag(first, last, tag, tag);
+}
+
+// Returns the first pair whose tag is in range, or last.
+template <typename Pair>
+Pair* find_if_tag(Pair* first, Pair* last,
+                  typename detail::tag_scan_traits<Pair>::int_type lo,
+                  typename detail::tag_scan_traits<Pair>::int_type hi)
+{
+    detail::tag_matcher<std::remove_const_t<Pair>> match{ lo, hi };
+
+#if defined(__AVX512F__)
+    for (; last - first >= 8; first += 8) {
+        if (unsigned m = match.match8(first)) {
+            return first + detail::lowest_bit8(m);
+        }
+    }
+#elif defined(__AVX2__)
+    for (; last - first >= 4; first += 4) {
+        if (unsigned m = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(match.match4(first))))) {
+            return first + detail::lowest_bit8(m);
+        }
+    }
+#endif
+    for (; first != last; ++first) {
+        if (match(*first)) return first;
+    }
+    return last;
+}
+
+template <typename Pair>
+Pair* find_if_tag(Pair* first, Pair* last, typename detail::tag_scan_traits<Pair>::int_type tag) {
+    return find_if_tag(first, last, tag, tag);
+}
+
+// Copies the pairs whose tag is in range to out, keeping their order, and
+// returns the end of the output. out must not overlap [first, last) unless
+// out == first.
+template <typename Pair>
+Pair* compress_store_by_tag(const Pair* first, const Pair* last, Pair* out,
+                            typename detail::tag_scan_traits<Pair>::int_type lo,
+                            typename detail::tag_scan_traits<Pair>::int_type hi)
+{
+    return detail::compress_by_tag<true>(first, last, out, detail::tag_matcher<Pair>{ lo, hi });
+}
+
+template <typename Pair>
+Pair* compress_store_by_tag(const Pair* first, const Pair* last, Pair* out, typename detail::tag_scan_traits<Pair>::int_type tag) {
+    return compress_store_by_tag(first, last, out, tag, tag);
+}
+
+// Stable partition: pairs whose tag is in range move to the front. Returns
+// the partition point. Non matching pairs go through a temporary buffer.
+template <typename Pair>
+Pair* partition_by_tag(Pair* first, Pair* last,
+                       typename detail::tag_scan_traits<Pair>::int_type lo,
+                       typename detail::tag_scan_traits<Pair>::int_type hi)
+{
+    detail::tag_matcher<Pair> match{ lo, hi };
+
+    std::vector<Pair> rest(static_cast<std::size_t>(last - first) - count_if_tag(first, last, lo, hi));
+    detail::compress_by_tag<false>(first, last, rest.data(), match);
+    auto middle = detail::compress_by_tag<true>(first, last, first, match);
+    std::copy(rest.begin(), rest.end(), middle);
+    return middle;
+}
+
+template <typename Pair>
+Pair* partition_by_tag(Pair* first, Pair* last, typename detail::tag_scan_traits<Pair>::int_type tag) {
+    return partition_by_tag(first, last, tag, tag);
+}
+
+// Adds the number of pairs carrying each tag to counts, which is indexed by
+// the unsigned bit pattern of the tag and must hold 1 << (8 * sizeof(IntType))
+// entries.
+template <typename Pair>
+void histogram_of_tags(const Pair* first, const Pair* last, std::size_t* counts) noexcept {
+    for (; first != last; ++first) {
+        ++counts[(first->raw() >> 48) & detail::tag_scan_traits<Pair>::mask];
+    }
+}
@@ -0,0 +1,90 @@
+#include "test.h"
+#include "tag_scan.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST_CASE("tag scans") {
+    using pair_type = ptr_int_pair_48va<int, short>;
+
+    std::vector<int> storage(64);
+    std::mt19937_64 rng{ 11 };
+    std::uniform_int_distribution<int> tag{ -8, 8 };
+
+    // Odd length so that the scalar tail runs after the vector loop.
+    std::vector<pair_type> pairs;
+    for (int i = 0; i < 1001; ++i) {
+        pairs.emplace_back(&storage[i % 64], static_cast<short>(tag(rng)));
+    }
+    pairs.emplace_back(reinterpret_cast<int*>(std::uintptr_t(0xffff800000000040)), -3);
+    pairs.emplace_back(nullptr, 3);
+
+    const auto first = pairs.data();
+    const auto last = pairs.data() + pairs.size();
+    auto in_range = [](short lo, short hi) {
+        return [lo, hi](const pair_type &p) { return p.integer() >= lo && p.integer() <= hi; };
+    };
+
+    GIVEN("counting") {
+        CHECK(count_if_tag(first, last, short(3)) == static_cast<std::size_t>(std::count_if(pairs.begin(), pairs.end(), in_range(3, 3))));
+        CHECK(count_if_tag(first, last, -3, 2) == static_cast<std::size_t>(std::count_if(pairs.begin(), pairs.end(), in_range(-3, 2))));
+        CHECK(count_if_tag(first, last, 100) == 0);
+        CHECK(count_if_tag(first, first, 0) == 0);
+    }
+
+    GIVEN("finding") {
+        for (short t = -9; t <= 9; ++t) {
+            CHECK(find_if_tag(first, last, t) == first + (std::find_if(pairs.begin(), pairs.end(), in_range(t, t)) - pairs.begin()));
+        }
+        CHECK(find_if_tag(first + 5, last, 4, 8) == first + (std::find_if(pairs.begin() + 5, pairs.end(), in_range(4, 8)) - pairs.begin()));
+
+        const pair_type* cfirst = first;
+        CHECK(find_if_tag(cfirst, cfirst + pairs.size(), 100) == cfirst + pairs.size());
+    }
+
+    GIVEN("compress store") {
+        std::vector<pair_type> expected, out(pairs.size());
+        std::copy_if(pairs.begin(), pairs.end(), std::back_inserter(expected), in_range(-2, 5));
+
+        auto end = compress_store_by_tag(first, last, out.data(), -2, 5);
+        out.resize(static_cast<std::size_t>(end - out.data()));
+        CHECK(out == expected);
+    }
+
+    GIVEN("partition") {
+        auto expected = pairs;
+        std::stable_partition(expected.begin(), expected.end(), in_range(-8, -1));
+
+        auto middle = partition_by_tag(first, last, -8, -1);
+        CHECK(pairs == expected);
+        CHECK(middle - first == std::count_if(pairs.begin(), pairs.end(), in_range(-8, -1)));
+    }
+
+    GIVEN("histogram") {
+        std::vector<std::size_t> counts(1 << 16);
+        histogram_of_tags(first, last, counts.data());
+
+        for (short t = -8; t <= 8; ++t) {
+            CHECK(counts[static_cast<unsigned short>(t)] == static_cast<std::size_t>(std::count_if(pairs.begin(), pairs.end(), in_range(t, t))));
+        }
+    }
+}
+
+TEST_CASE("tag scans with one byte tags") {
+    using pair_type = ptr_int_pair_48va<int, signed char>;
+
+    int value = 0;
+    std::vector<pair_type> pairs;
+    for (int i = 0; i < 37; ++i) {
+        pairs.emplace_back(&value, static_cast<signed char>(i % 2 ? -i : i));
+    }
+
+    CHECK(count_if_tag(pairs.data(), pairs.data() + pairs.size(), -128, -1) == 18);
+    CHECK(find_if_tag(pairs.data(), pairs.data() + pairs.size(), -5) == pairs.data() + 5);
+
+    std::vector<std::size_t> counts(1 << 8);
+    histogram_of_tags(pairs.data(), pairs.data() + pairs.size(), counts.data());
+    CHECK(counts[static_cast<unsigned char>(-5)] == 1);
+    CHECK(counts[0] == 1);
+}
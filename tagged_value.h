@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "ptr_int_pair_48va.h"
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+// A word that holds either a T* or a 63 bit signed integer, so small
+// integers don't need a heap box to sit next to object pointers. Integers
+// are stored shifted left by one with the low bit set; pointers are stored
+// as a ptr_int_pair_48va, with the low bit clear (T must be at least 2 byte
+// aligned) and a 16 bit tag of their own in the high bits, e.g. an object
+// kind that can be checked without touching the object.
+
+namespace detail {
+
+    // Each returns false on overflow and leaves result unspecified.
+    inline bool checked_add(std::int64_t lhs, std::int64_t rhs, std::int64_t &result) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_add_overflow(lhs, rhs, &result);
+#else
+        result = static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) + static_cast<std::uint64_t>(rhs));
+        return !((lhs >= 0) == (rhs >= 0) && (result >= 0) != (lhs >= 0));
+#endif
+    }
+
+    inline bool checked_sub(std::int64_t lhs, std::int64_t rhs, std::int64_t &result) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_sub_overflow(lhs, rhs, &result);
+#else
+        result = static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) - static_cast<std::uint64_t>(rhs));
+        return !((lhs >= 0) != (rhs >= 0) && (result >= 0) != (lhs >= 0));
+#endif
+    }
+
+    inline bool checked_mul(std::int64_t lhs, std::int64_t rhs, std::int64_t &result) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return !__builtin_mul_overflow(lhs, rhs, &result);
+#else
+        constexpr auto max = std::numeric_limits<std::int64_t>::max();
+        constexpr auto min = std::numeric_limits<std::int64_t>::min();
+        if (lhs > 0 ? (rhs > 0 ? lhs > max / rhs : rhs < min / lhs)
+                    : (rhs > 0 ? lhs < min / rhs : lhs != 0 && rhs < max / lhs)) {
+            return false;
+        }
+        result = lhs * rhs;
+        return true;
+#endif
+    }
+
+}
+
+template <typename T>
+class tagged_value {
+
+public:
+
+    using int_type = std::int64_t;
+    using tag_type = std::uint16_t;
+
+    static constexpr int int_bits = 63;
+    static constexpr int_type max_int = std::numeric_limits<int_type>::max() >> 1;
+    static constexpr int_type min_int = std::numeric_limits<int_type>::min() >> 1;
+
+private:
+
+    using pair_type = ptr_int_pair_48va<T, tag_type>;
+
+    static constexpr std::uint64_t int_flag = 1;
+
+    std::uint64_t m_raw;
+
+    struct raw_tag {};
+
+    constexpr tagged_value(raw_tag, std::uint64_t raw)
+    :m_raw{ raw }
+    {}
+
+    static constexpr std::uint64_t encode_int(int_type i) {
+        return (static_cast<std::uint64_t>(i) << 1) | int_flag;
+    }
+
+    // The shifted integer without the flag, i.e. 2 * as_int().
+    constexpr int_type doubled() const {
+        return static_cast<int_type>(m_raw ^ int_flag);
+    }
+
+public:
+
+    //
+    // Constructors
+    //
+
+    constexpr tagged_value()
+    :m_raw{ encode_int(0) }
+    {}
+
+    tagged_value(T* ptr, tag_type tag = 0)
+    :m_raw{ pair_type{ ptr, tag }.raw() }
+    {
+        ASSERT(!(m_raw & int_flag));
+    }
+
+    static constexpr bool fits_int(int_type i) {
+        return i >= min_int && i <= max_int;
+    }
+
+    static inline tagged_value from_int(int_type i) {
+        ASSERT(fits_int(i));
+        return tagged_value{ raw_tag{}, encode_int(i) };
+    }
+
+    static constexpr tagged_value from_raw(std::uint64_t raw) {
+        return tagged_value{ raw_tag{}, raw };
+    }
+
+    //
+    // Accessors
+    //
+
+    constexpr bool is_int() const {
+        return m_raw & int_flag;
+    }
+
+    constexpr bool is_ptr() const {
+        return !is_int();
+    }
+
+    // Arithmetic shift, which brings the sign back.
+    inline int_type as_int() const {
+        ASSERT(is_int());
+        return doubled() >> 1;
+    }
+
+    inline T* as_ptr() const {
+        ASSERT(is_ptr());
+        return pair_type::from_raw(m_raw).pointer();
+    }
+
+    inline tag_type ptr_tag() const {
+        ASSERT(is_ptr());
+        return pair_type::from_raw(m_raw).integer();
+    }
+
+    constexpr std::uint64_t raw() const {
+        return m_raw;
+    }
+
+    //
+    // Arithmetic
+    //
+
+    // Each works on the tagged words directly and returns false, leaving
+    // result untouched, if the exact result doesn't fit in 63 bits. Both
+    // operands must be integers.
+
+    static inline bool checked_add(tagged_value lhs, tagged_value rhs, tagged_value &result) noexcept {
+        ASSERT(lhs.is_int() && rhs.is_int());
+        int_type sum;
+        if (!detail::checked_add(lhs.doubled(), static_cast<int_type>(rhs.m_raw), sum)) return false;
+        result.m_raw = static_cast<std::uint64_t>(sum);
+        return true;
+    }
+
+    static inline bool checked_sub(tagged_value lhs, tagged_value rhs, tagged_value &result) noexcept {
+        ASSERT(lhs.is_int() && rhs.is_int());
+        int_type difference;
+        if (!detail::checked_sub(static_cast<int_type>(lhs.m_raw), rhs.doubled(), difference)) return false;
+        result.m_raw = static_cast<std::uint64_t>(difference);
+        return true;
+    }
+
+    static inline bool checked_mul(tagged_value lhs, tagged_value rhs, tagged_value &result) noexcept {
+        ASSERT(lhs.is_int() && rhs.is_int());
+        int_type product;
+        if (!detail::checked_mul(lhs.as_int(), rhs.doubled(), product)) return false;
+        result.m_raw = static_cast<std::uint64_t>(product) | int_flag;
+        return true;
+    }
+
+    static inline bool checked_neg(tagged_value value, tagged_value &result) noexcept {
+        return checked_sub(tagged_value{}, value, result);
+    }
+
+    //
+    // Comparators
+    //
+
+    // Identity: equal integers, or the same pointer with the same tag.
+    constexpr bool operator==(const tagged_value &other) const {
+        return m_raw == other.m_raw;
+    }
+
+    constexpr bool operator!=(const tagged_value &other) const {
+        return !operator==(other);
+    }
+};
+
+// Out of line definitions so the limits can be bound to references before
+// C++17 made static constexpr members inline.
+template <typename T>
+constexpr int tagged_value<T>::int_bits;
+
+template <typename T>
+constexpr typename tagged_value<T>::int_type tagged_value<T>::max_int;
+
+template <typename T>
+constexpr typename tagged_value<T>::int_type tagged_value<T>::min_int;
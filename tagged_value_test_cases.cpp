@@ -0,0 +1,76 @@
+#include "test.h"
+#include "tagged_value.h"
+
+#include <vector>
+
+namespace {
+
+    struct object {
+        int kind;
+    };
+
+}
+
+TEST_CASE("tagged value") {
+    using value = tagged_value<object>;
+
+    GIVEN("a default constructed value") {
+        value v;
+        CHECK(v.is_int());
+        CHECK(v.as_int() == 0);
+    }
+
+    GIVEN("integers") {
+        for (auto i : { value::int_type(0), value::int_type(1), value::int_type(-1), value::int_type(123456789012345),
+                        value::int_type(-98765432109876), value::max_int, value::min_int }) {
+            auto v = value::from_int(i);
+            CHECK(v.is_int());
+            CHECK(!v.is_ptr());
+            CHECK(v.as_int() == i);
+        }
+
+        CHECK(value::fits_int(value::max_int));
+        CHECK(!value::fits_int(value::max_int + 1));
+        CHECK(!value::fits_int(value::min_int - 1));
+    }
+
+    GIVEN("pointers") {
+        std::vector<object> objects(4);
+        value v{ &objects[2], 7 };
+        value null{ nullptr };
+
+        CHECK(v.is_ptr());
+        CHECK(v.as_ptr() == &objects[2]);
+        CHECK(v.ptr_tag() == 7);
+        CHECK(null.is_ptr());
+        CHECK(null.as_ptr() == nullptr);
+        CHECK(v != value::from_int(0));
+        CHECK(v == value::from_raw(v.raw()));
+    }
+
+    GIVEN("checked arithmetic") {
+        value r;
+
+        CHECK(value::checked_add(value::from_int(40), value::from_int(2), r));
+        CHECK(r.as_int() == 42);
+        CHECK(value::checked_sub(value::from_int(-40), value::from_int(2), r));
+        CHECK(r.as_int() == -42);
+        CHECK(value::checked_mul(value::from_int(-6), value::from_int(7), r));
+        CHECK(r.as_int() == -42);
+        CHECK(value::checked_neg(value::from_int(42), r));
+        CHECK(r.as_int() == -42);
+
+        auto before = value::from_int(5);
+        r = before;
+        CHECK(!value::checked_add(value::from_int(value::max_int), value::from_int(1), r));
+        CHECK(!value::checked_sub(value::from_int(value::min_int), value::from_int(1), r));
+        CHECK(!value::checked_mul(value::from_int(value::max_int / 2 + 1), value::from_int(2), r));
+        CHECK(!value::checked_neg(value::from_int(value::min_int), r));
+        CHECK(r == before);
+
+        CHECK(value::checked_add(value::from_int(value::max_int), value::from_int(value::min_int), r));
+        CHECK(r.as_int() == -1);
+        CHECK(value::checked_mul(value::from_int(value::min_int / 2), value::from_int(2), r));
+        CHECK(r.as_int() == value::min_int);
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "ptr_int_pair_48va.h"
+
+#ifndef ASSERT
+#define ASSERT(X) assert(X)
+#endif
+
+namespace detail {
+
+    template <typename T, typename... L>
+    struct type_index;
+
+    template <typename T, typename... R>
+    struct type_index<T, T, R...> {
+        static constexpr std::size_t value = 0;
+    };
+
+    template <typename T, typename F, typename... R>
+    struct type_index<T, F, R...> {
+        static constexpr std::size_t value = type_index<T, R...>::value + 1;
+    };
+
+    template <typename T, typename... L>
+    struct type_count {
+        static constexpr std::size_t value = 0;
+    };
+
+    template <typename T, typename F, typename... R>
+    struct type_count<T, F, R...> {
+        static constexpr std::size_t value = std::size_t(std::is_same<T, F>::value) + type_count<T, R...>::value;
+    };
+
+    template <typename... Ts>
+    struct first_type;
+
+    template <typename F, typename... R>
+    struct first_type<F, R...> {
+        using type = F;
+    };
+
+}
+
+template <typename... Ts>
+class tagged_variant_ptr {
+
+public:
+
+    using index_type = std::uint16_t;
+
+    static_assert(sizeof...(Ts) > 0, "tagged_variant_ptr requires at least one alternative");
+    static_assert(sizeof...(Ts) <= std::size_t(std::numeric_limits<index_type>::max()) + 1, "Too many alternatives for a 16 bit index");
+
+private:
+
+    using buffer_type = ptr_int_pair_48va<const void, index_type>;
+
+    template <typename T>
+    using enable_if_alternative = std::enable_if_t<detail::type_count<T, Ts...>::value == 1>;
+
+    // A T* may also be stored as a const T alternative.
+    template <typename T>
+    using alternative_type = std::conditional_t<detail::type_count<T, Ts...>::value == 1, T, const T>;
+
+    buffer_type m_buffer;
+
+    template <typename T>
+    static inline T* cast(const void* ptr) noexcept {
+        return static_cast<T*>(const_cast<void*>(ptr));
+    }
+
+    // One entry per alternative; the table is indexed by the tag so the
+    // pointee is only touched by the selected handler.
+    template <typename Visitor, typename T>
+    static decltype(auto) dispatch(Visitor &&vis, const void* ptr) {
+        return std::forward<Visitor>(vis)(*cast<T>(ptr));
+    }
+
+public:
+
+    //
+    // Constructors
+    //
+
+    constexpr tagged_variant_ptr() = default;
+
+    template <typename T, typename = enable_if_alternative<alternative_type<T>>>
+    tagged_variant_ptr(T* ptr)
+    :m_buffer{ ptr, static_cast<index_type>(detail::type_index<alternative_type<T>, Ts...>::value) }
+    {}
+
+    //
+    // Accessors
+    //
+
+    constexpr index_type index() const {
+        return m_buffer.integer();
+    }
+
+    constexpr const void* pointer() const {
+        return m_buffer.pointer();
+    }
+
+    explicit constexpr operator bool() const {
+        return pointer() != nullptr;
+    }
+
+    template <typename T, typename = enable_if_alternative<T>>
+    constexpr bool holds() const {
+        return index() == detail::type_index<T, Ts...>::value;
+    }
+
+    template <typename T, typename = enable_if_alternative<T>>
+    inline T* get() const {
+        ASSERT(holds<T>());
+        return cast<T>(pointer());
+    }
+
+    template <typename T, typename = enable_if_alternative<T>>
+    inline T* get_if() const noexcept {
+        return holds<T>() ? cast<T>(pointer()) : nullptr;
+    }
+
+    template <typename Visitor>
+    inline decltype(auto) visit(Visitor &&vis) const {
+        using first_alternative = typename detail::first_type<Ts...>::type;
+        using result_type = decltype(dispatch<Visitor, first_alternative>(std::declval<Visitor>(), nullptr));
+        using handler_type = result_type(*)(Visitor&&, const void*);
+
+        static_assert(detail::type_count<result_type, decltype(dispatch<Visitor, Ts>(std::declval<Visitor>(), nullptr))...>::value == sizeof...(Ts),
+                      "The visitor must return the same type for every alternative");
+
+        static constexpr handler_type table[] = { &dispatch<Visitor, Ts>... };
+
+        ASSERT(*this);
+        return table[index()](std::forward<Visitor>(vis), pointer());
+    }
+
+    //
+    // Modifiers
+    //
+
+    template <typename T, typename = enable_if_alternative<alternative_type<T>>>
+    inline void reset(T* ptr) noexcept {
+        m_buffer = buffer_type{ ptr, static_cast<index_type>(detail::type_index<alternative_type<T>, Ts...>::value) };
+    }
+
+    inline void clear() noexcept {
+        m_buffer.clear();
+    }
+
+    inline void swap(tagged_variant_ptr &other) noexcept {
+        m_buffer.swap(other.m_buffer);
+    }
+
+    //
+    // Comparators
+    //
+
+    constexpr bool operator==(const tagged_variant_ptr &other) const {
+        return m_buffer == other.m_buffer;
+    }
+
+    constexpr bool operator!=(const tagged_variant_ptr &other) const {
+        return !operator==(other);
+    }
+};
+
+template <typename Visitor, typename... Ts>
+inline decltype(auto) visit(Visitor &&vis, const tagged_variant_ptr<Ts...> &ptr) {
+    return ptr.visit(std::forward<Visitor>(vis));
+}
+
+template <typename... Ts>
+inline void swap(tagged_variant_ptr<Ts...> &lhs, tagged_variant_ptr<Ts...> &rhs) noexcept {
+    lhs.swap(rhs);
+}
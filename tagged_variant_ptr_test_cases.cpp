@@ -0,0 +1,128 @@
+#include "test.h"
+#include "tagged_variant_ptr.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct literal;
+    struct add;
+    struct negate;
+
+    using expression = tagged_variant_ptr<const literal, const add, const negate>;
+
+    struct literal {
+        int value;
+    };
+
+    struct add {
+        expression lhs;
+        expression rhs;
+    };
+
+    struct negate {
+        expression operand;
+    };
+
+    struct evaluator {
+        int operator()(const literal &node) const {
+            return node.value;
+        }
+
+        int operator()(const add &node) const {
+            return node.lhs.visit(*this) + node.rhs.visit(*this);
+        }
+
+        int operator()(const negate &node) const {
+            return -node.operand.visit(*this);
+        }
+    };
+
+}
+
+TEST_CASE("tagged variant pointer") {
+    GIVEN("default constructed") {
+        tagged_variant_ptr<int, std::string> p;
+
+        CHECK(!p);
+        CHECK(p.pointer() == nullptr);
+        CHECK(p.index() == 0);
+    }
+
+    GIVEN("constructed with alternatives") {
+        int x = 1;
+        std::string str = "foo";
+
+        tagged_variant_ptr<int, std::string> p{ &x };
+        tagged_variant_ptr<int, std::string> q{ &str };
+
+        CHECK(p);
+        CHECK(p.index() == 0);
+        CHECK(p.holds<int>());
+        CHECK(!p.holds<std::string>());
+        CHECK(p.get<int>() == &x);
+        CHECK(p.get_if<std::string>() == nullptr);
+
+        CHECK(q.index() == 1);
+        CHECK(q.holds<std::string>());
+        CHECK(*q.get<std::string>() == "foo");
+        CHECK(q.get_if<int>() == nullptr);
+
+        CHECK(p != q);
+        swap(p, q);
+        CHECK(p.get<std::string>() == &str);
+        CHECK(q.get<int>() == &x);
+
+        p.reset(&x);
+        CHECK(p == q);
+
+        p.clear();
+        CHECK(!p);
+    }
+
+    GIVEN("visit") {
+        int x = 3;
+        std::string str = "foobar";
+
+        tagged_variant_ptr<int, std::string> p{ &x };
+        tagged_variant_ptr<int, std::string> q{ &str };
+
+        struct size_of {
+            std::size_t operator()(int &i) const { return static_cast<std::size_t>(i); }
+            std::size_t operator()(std::string &s) const { return s.size(); }
+        };
+
+        CHECK(p.visit(size_of{}) == 3);
+        CHECK(visit(size_of{}, q) == 6);
+
+        struct append {
+            void operator()(int &i) const { i += 1; }
+            void operator()(std::string &s) const { s += "!"; }
+        };
+
+        visit(append{}, p);
+        visit(append{}, q);
+        CHECK(x == 4);
+        CHECK(str == "foobar!");
+    }
+
+    GIVEN("expression tree") {
+        // -(1 + (2 + 3))
+        literal one{ 1 }, two{ 2 }, three{ 3 };
+        add inner{ &two, &three };
+        add outer{ &one, &inner };
+        negate root{ &outer };
+
+        expression e{ &root };
+        CHECK(e.holds<const negate>());
+        CHECK(e.visit(evaluator{}) == -6);
+
+        std::vector<expression> nodes{ &one, &inner, &root };
+        int sum = 0;
+        for (const auto &n : nodes) {
+            sum += n.visit(evaluator{});
+        }
+        CHECK(sum == 1 + 5 - 6);
+    }
+}